@@ -19,9 +19,16 @@
 
 #include "engine/renderer.h"
 #include "engine/data_factory.h"
+#include "engine/profiler.h"
+#include "engine/upload_ring.h"
+#include "engine/gl_state.h"
+#include "engine/texture_loader.h"
 
 #include "terrain/terrain.h"
+#include "terrain/terrain_generator.h"
 #include "terrain/sculptor.hpp"
+#include "terrain/sculpt_history.h"
+#include "terrain/erosion.h"
 
 #include "effects/water.h"
 #include "effects/shadowmap.hpp"
@@ -31,15 +38,22 @@
 
 #include "raycasting/raycaster.hpp"
 
+#include "exporting/terrain_exporter.h"
+#include "exporting/heightmap_file.h"
+
 #include "shader_handlers/terrain_shader_handler.h"
 #include "shader_handlers/shadowmap_shader_handler.h"
 #include "shader_handlers/skybox_shader_handler.h"
 #include "shader_handlers/water_shader_handler.h"
+#include "shader_handlers/uniform_buffer.h"
 
 #undef main // Fixes weird SDL issue
 
 int main()
 {
+	//the startup phases up to the first frame on screen are timed to keep an eye on cold starts
+	Profiler::Get().BeginStartup();
+
 	const int displayWidth = 1366;
 	const int displayHeight = 768;
 	Renderer renderer = Renderer("TerraSim", displayWidth, displayHeight);
@@ -52,7 +66,10 @@ int main()
 	ShadowmapShaderHandler shadowmapShaderHandler = ShadowmapShaderHandler();
 	SkyboxShaderHandler skyboxShaderHandler = SkyboxShaderHandler();
 	WaterShaderHandler waterShaderHandler = WaterShaderHandler();
+	UniformBuffer frameUniformBuffer = UniformBuffer(FRAME_UNIFORM_BINDING, sizeof(FrameUniforms));
+	UniformBuffer lightUniformBuffer = UniformBuffer(LIGHT_UNIFORM_BINDING, sizeof(LightUniforms));
 	DataFactory dataFactory = DataFactory();
+	Profiler::Get().EndStartupPhase("Shaders");
 
 	//user inputs
 	bool keyW = false, keyA = false, keyS = false, keyD = false, keyQ = false, keyE = false;
@@ -71,17 +88,18 @@ int main()
 	static float sunIntensity = .3f;
 
 
-	//load the textures
+	//load the textures. they are decoded in the background and drawn as placeholders until they are uploaded
 	std::string workingDirectory = std::filesystem::current_path().string();
 	std::replace(workingDirectory.begin(), workingDirectory.end(), '\\', '/');
 	static float texScaleVal = 25.f;
-	GLuint textureID1 = dataFactory.LoadTexture(workingDirectory + "/resources/Base.png");
-	GLuint textureID2 = dataFactory.LoadTexture(workingDirectory + "/resources/Ground.png");
-	GLuint textureID3 = dataFactory.LoadTexture(workingDirectory + "/resources/Rock.png");
-	GLuint textureID4 = dataFactory.LoadTexture(workingDirectory + "/resources/Peaks.png");
+	TextureLoader textureLoader;
+	GLuint textureID1 = textureLoader.LoadTexture(dataFactory, workingDirectory + "/resources/Base.png");
+	GLuint textureID2 = textureLoader.LoadTexture(dataFactory, workingDirectory + "/resources/Ground.png");
+	GLuint textureID3 = textureLoader.LoadTexture(dataFactory, workingDirectory + "/resources/Rock.png");
+	GLuint textureID4 = textureLoader.LoadTexture(dataFactory, workingDirectory + "/resources/Peaks.png");
 	std::vector<GLuint> textureIDs = { textureID1, textureID2, textureID3, textureID4 };
 
-	GLuint skyboxTextureID = dataFactory.LoadCubemapTexture({
+	GLuint skyboxTextureID = textureLoader.LoadCubemapTexture(dataFactory, {
 		workingDirectory + "/resources/skybox/right.png",
 		workingDirectory + "/resources/skybox/left.png",
 		workingDirectory + "/resources/skybox/top.png",
@@ -90,12 +108,12 @@ int main()
 		workingDirectory + "/resources/skybox/front.png"
 	});	
 
-	GLuint dudvMapTextureID = dataFactory.LoadTexture(workingDirectory + "/resources/water/waterNormal.png");
-	GLuint normalmapTextureID = dataFactory.LoadTexture(workingDirectory + "/resources/water/waterDUDV.png");
+	GLuint dudvMapTextureID = textureLoader.LoadTexture(dataFactory, workingDirectory + "/resources/water/waterNormal.png");
+	GLuint normalmapTextureID = textureLoader.LoadTexture(dataFactory, workingDirectory + "/resources/water/waterDUDV.png");
+	Profiler::Get().EndStartupPhase("Textures");
 	
 	//terrain size
 	static int terrainSize = 256;
-	static int oldTerrainSize = terrainSize;
 	int terrainResolution = terrainSize * 2;
 
 	//Terrain logic
@@ -103,6 +121,10 @@ int main()
 	TerrainFactory terrainFactory = TerrainFactory();
 	Terrain terrain = terrainFactory.GenerateTerrain(dataFactory, terrainSize, terrainResolution, textureIDs, noiseSeed);
 	std::shared_ptr<Heightmap> heightmap = terrain.GetHeightmap();
+	SculptHistory sculptHistory = SculptHistory();
+	TerrainGenerator terrainGenerator;
+	ErosionSimulator erosion;
+	Profiler::Get().EndStartupPhase("Terrain");
 
 
 	//Skybox logic
@@ -112,6 +134,7 @@ int main()
 	//Water logic
 	WaterFactory waterFactory = WaterFactory();
 	Water water = waterFactory.GenerateWater(dataFactory, dudvMapTextureID, normalmapTextureID, terrainSize, displayWidth, displayHeight);
+	Profiler::Get().EndStartupPhase("Sky and water");
 
 	//for shadowmap
 	static bool shadowmapDirty = true;
@@ -130,6 +153,8 @@ int main()
 	float fps = 0;
 	const float maxDeltaTime = 1000.f / 250.f; //cap frame rate at 250. This is to ensure that extra resources aren't wasted on this application.
 	bool shouldRun = true;
+	bool startupTimed = false;
+	bool texturesTimed = false;
 
 	while (shouldRun) {
 
@@ -153,6 +178,9 @@ int main()
 			SDL_Delay(static_cast<Uint32>(maxDeltaTime - deltaTime));
 		}
 
+		Profiler& profiler = Profiler::Get();
+		profiler.BeginFrame();
+
 		SDL_Event e;
 		while (SDL_PollEvent(&e)) {
 			ImGui_ImplSDL2_ProcessEvent(&e);
@@ -171,6 +199,17 @@ int main()
 				if (key == SDLK_q) keyQ = keyDown;
 				if (key == SDLK_e) keyE = keyDown;
 				if (key == SDLK_LSHIFT) keyLeftShift = keyDown;
+
+				//ctrl+z undoes the last sculpt stroke, ctrl+y or ctrl+shift+z redoes it
+				if (keyDown && (SDL_GetModState() & KMOD_CTRL) && !ImGui::GetIO().WantCaptureKeyboard && !terrainGenerator.IsBusy() && !terrain.IsReplacing()) {
+					bool redo = key == SDLK_y || (key == SDLK_z && (SDL_GetModState() & KMOD_SHIFT));
+					if (redo && sculptHistory.Redo(*heightmap)) {
+						terrain.Update();
+					}
+					else if (!redo && key == SDLK_z && sculptHistory.Undo(*heightmap)) {
+						terrain.Update();
+					}
+				}
 			}
 			else if (e.type == SDL_MOUSEBUTTONDOWN) {
 				auto button = e.button.button;
@@ -201,6 +240,42 @@ int main()
 			} 
 		}
 
+		//textures decoded since the last frame replace their placeholders
+		if (textureLoader.IsBusy()) {
+			ProfileScope textureScope("Textures", true);
+			textureLoader.Update();
+			if (!textureLoader.IsBusy() && !texturesTimed) {
+				printf("Textures ready %.1f ms after launch\n", profiler.GetTimeSinceStartup());
+				texturesTimed = true;
+			}
+		}
+
+		//regenerated terrains come from a worker and are uploaded a slice per frame, the current terrain keeps rendering
+		//until the whole replacement is on the gpu
+		static bool replacementIsPreview = false;
+		std::unique_ptr<GeneratedTerrain> generatedTerrain = terrainGenerator.TakeResult();
+		if (generatedTerrain) {
+			replacementIsPreview = generatedTerrain->preview;
+			terrain.BeginReplacement(std::move(generatedTerrain), dataFactory);
+		}
+		if (terrain.IsReplacing()) {
+			ProfileScope uploadScope("Upload", true);
+			float previousSize = terrain.GetHeightmap()->GetSize();
+			if (terrain.UpdateReplacement()) {
+				//previews are only drawn, heightmap stays the full resolution one that is edited and saved
+				if (!replacementIsPreview) {
+					heightmap = terrain.GetHeightmap();
+					sculptHistory.Clear();
+				}
+				if (terrain.GetHeightmap()->GetSize() != previousSize) {
+					water = waterFactory.GenerateWater(dataFactory, dudvMapTextureID, normalmapTextureID, terrain.GetHeightmap()->GetSize(), displayWidth, displayHeight);
+				}
+				shadowmapDirty = true;
+			}
+		}
+		//while the terrain is regenerated the heightmap isn't the one being drawn, so it can't be sculpted
+		bool regenerating = terrainGenerator.IsBusy() || terrain.IsReplacing();
+
 		camera.Update(deltaTime, keyW, keyA, keyS, keyD, keyQ, keyE, keyLeftShift, mouseDeltaX, mouseDeltaY, displayWidth, displayHeight);	
 
 		//shadowmap
@@ -209,6 +284,7 @@ int main()
 		//projectionMatrix
 		glm::mat4 projectionMatrix = renderer.GetProjectionMatrix();
 		glm::mat4 viewMatrix = camera.GetViewMatrix();
+		TerrainSelection cameraSelection = terrain.SelectLod(Frustum(projectionMatrix * viewMatrix), camera.position, renderer.GetLodDistance());
 
 		//water
 		moveFactor += water.WaveSpeed * deltaTime;
@@ -219,12 +295,15 @@ int main()
 
 		//render terrain to shadowmap if light has moved (shadowmapDirty)
 		if(shadowmapDirty) {
+			ProfileScope shadowScope("Shadow", true);
 			shadowmap.BindFrameBuffer();		
 			glm::mat4 lightProjectionMatrix = light.GetProjectionMatrix();
 			glm::mat4 lightViewMatrix = light.GetViewMatrix();
 			shadowmapShaderHandler.Enable();
 			shadowmapShaderHandler.SetLightViewProjection(lightProjectionMatrix * lightViewMatrix);
-			renderer.RenderTerrain(terrain, terrainShaderHandler, shadowmap);
+			//the shadowmap is only redrawn when the light moves, so it can't follow the camera's level of detail.
+			//it has as many texels as the heightmap, half the grid resolution is plenty
+			renderer.RenderTerrainDepth(terrain, shadowmapShaderHandler, terrain.SelectLevel(Frustum(lightProjectionMatrix * lightViewMatrix), 1));
 			shadowmapShaderHandler.Disable();
 			shadowmap.UnbindFrameBuffer();
 			shadowmapDirty = false;
@@ -233,8 +312,22 @@ int main()
 		// prepare the next main frame for rendering
 		renderer.PrepareFrame();
 
+		//the camera and the sun are the same for every program of the frame, so they are sent once
+		FrameUniforms frameUniforms;
+		frameUniforms.viewProjection = projectionMatrix * viewMatrix;
+		frameUniforms.cameraPosition = camera.position;
+		frameUniformBuffer.Update(frameUniforms);
+		LightUniforms lightUniforms;
+		lightUniforms.lightDirection = light.lightDirection;
+		lightUniforms.brightness = light.brightness;
+		lightUniforms.sunColor = light.sunColor;
+		lightUniforms.sunFalloff = light.sunFalloff;
+		lightUniforms.sunIntensity = light.sunIntensity;
+		lightUniformBuffer.Update(lightUniforms);
+
 		if (waterEnabled) {
 			//reflection pass		
+			profiler.BeginScope("Reflection", true);
 			water.BindFramebuffer(0);
 			glm::mat4 waterViewMatrix = camera.GetReflectionViewMatrix(water.WaterHeight);
 
@@ -243,55 +336,44 @@ int main()
 			renderer.RenderSkybox(skybox, skyboxShaderHandler);
 			skyboxShaderHandler.Disable();
 			water.UnbindFramebuffer();
+			profiler.EndScope();
 			
 			//refraction pass
+			profiler.BeginScope("Refraction", true);
 			water.BindFramebuffer(1);
 
 			terrainShaderHandler.Enable();
 			terrainShaderHandler.SetClip(refractionClip);
-			terrainShaderHandler.SetViewProjection(projectionMatrix * viewMatrix);
-			renderer.RenderTerrain(terrain, terrainShaderHandler, shadowmap);
+			renderer.RenderTerrain(terrain, terrainShaderHandler, shadowmap, cameraSelection);
 			terrainShaderHandler.Disable();
 
 			water.UnbindFramebuffer();			
+			profiler.EndScope();
 		}
 
 		//lighting pass
 		{
+			profiler.BeginScope("Skybox", true);
 			skyboxShaderHandler.Enable();
-			skyboxShaderHandler.SetLightDirection(light.lightDirection);
-			skyboxShaderHandler.SetSunFalloff(light.sunFalloff);
-			skyboxShaderHandler.SetSunIntensity(light.sunIntensity);
-			skyboxShaderHandler.SetSunColor(light.sunColor);
 			skyboxShaderHandler.SetViewProjection(projectionMatrix* glm::mat4(glm::mat3(viewMatrix)));
 			renderer.RenderSkybox(skybox, skyboxShaderHandler);
 			skyboxShaderHandler.Disable();
+			profiler.EndScope();
 
+			profiler.BeginScope("Terrain", true);
 			terrainShaderHandler.Enable();
 			terrainShaderHandler.SetMinHeight(terrain.GetMinHeight());
 			terrainShaderHandler.SetMaxHeight(terrain.GetMaxHeight());
-			terrainShaderHandler.SetViewProjection(projectionMatrix* viewMatrix);
-			terrainShaderHandler.SetLightDirection(light.lightDirection);
-			terrainShaderHandler.SetBrightness(light.brightness);
-			terrainShaderHandler.SetSunFalloff(light.sunFalloff);
-			terrainShaderHandler.SetSunIntensity(light.sunIntensity);
-			terrainShaderHandler.SetSunColor(light.sunColor);
-			terrainShaderHandler.SetCameraPosition(camera.position);
 			terrainShaderHandler.SetTextureScale(texScaleVal);
 			terrainShaderHandler.SetClip(defaultClip);
-			renderer.RenderTerrain(terrain, terrainShaderHandler, shadowmap);
+			renderer.RenderTerrain(terrain, terrainShaderHandler, shadowmap, cameraSelection);
 			terrainShaderHandler.Disable();
+			profiler.EndScope();
 
 			if (waterEnabled) {
+				ProfileScope waterScope("Water", true);
 				waterShaderHandler.Enable();
-				waterShaderHandler.SetViewProjection(projectionMatrix* viewMatrix);
 				waterShaderHandler.SetMoveFactor(moveFactor);
-				waterShaderHandler.SetLightDirection(light.lightDirection);
-				waterShaderHandler.SetCameraPosition(camera.position);
-				waterShaderHandler.SetBrightness(light.brightness);
-				waterShaderHandler.SetSunFalloff(light.sunFalloff);
-				waterShaderHandler.SetSunColor(light.sunColor);
-				waterShaderHandler.SetSunIntensity(light.sunIntensity);
 				waterShaderHandler.SetWaterHeight(water.WaterHeight);
 				waterShaderHandler.SetWaterShininess(water.WaterShininess);
 				renderer.RenderWater(water, waterShaderHandler);
@@ -302,6 +384,8 @@ int main()
 		//render the ImGUI
 		renderer.PrepareImGuiFrame();
 		{
+			ProfileScope uiScope("UI");
+
 			ImGui::Begin("Light Settings"); {
 				ImGui::PushItemWidth(150);
 				ImGui::SliderFloat("Light Azimuth", &azimuthVal, 0.f, 360.f);
@@ -331,12 +415,33 @@ int main()
 			}
 			ImGui::End();
 
+			static const char* noiseTypes[] = {
+				"Simplex Fractal",
+				"fBm Mountain Range"
+			};
+
+			//layer changes are composed right away when every layer's noise is cached and nothing is being generated. anything
+			//else goes to the background generator with a snapshot of the layers. the sculpting is kept while the size stays
+			auto ApplyLayerChanges = [&](float size) {
+				if (size == heightmap->GetSize() && !regenerating && terrain.GetHeightmap() == heightmap && heightmap->HasLayerNoise()) {
+					heightmap->UpdateLayers();
+					ProfileScope uploadScope("Upload", true);
+					terrain.Update();
+					sculptHistory.Clear(); // the history holds absolute heights
+					return;
+				}
+				TerrainGenerationSettings settings;
+				settings.size = size;
+				settings.layers = heightmap->GetLayers();
+				if (size == heightmap->GetSize()) {
+					settings.sculptLayer = heightmap->GetSculptLayer();
+				}
+				terrainGenerator.Request(settings);
+				regenerating = true;
+			};
+
 			ImGui::Begin("Terrain Generation Settings"); {
 				ImGui::PushItemWidth(150);
-				static const char* noiseTypes[] = {
-					"Simplex Fractal",
-					"fBm Mountain Range"
-				};
 				static int noiseType = 0;
 				ImGui::Combo("Noise Type", &noiseType, noiseTypes, sizeof(noiseTypes) / sizeof(noiseTypes[0]));
 
@@ -344,7 +449,7 @@ int main()
 				bool frequencyChanged = ImGui::SliderFloat("Frequency", &frequency, 0.f, 1.f);
 
 				ImGui::InputInt("Terrain Size", &terrainSize);
-				terrainSize = std::clamp(terrainSize, 0, 1000);
+				terrainSize = std::clamp(terrainSize, 0, 2048);
 
 				static bool keepSeed = true;
 				ImGui::Checkbox("Keep Noise Seed", &keepSeed);
@@ -354,27 +459,109 @@ int main()
 					noiseSeed = heightmap->GetNoiseSeed();
 				}
 
+				//the base layer always holds the latest settings, the heights follow once they are composed or generated.
+				//an amplitude change only rescales the cached noise, in a single pass while no other layer is switched on
+				auto SetBaseLayer = [&](float size, float seed) {
+					std::vector<HeightmapLayer> layers = heightmap->GetLayers();
+					if (layers.empty()) {
+						layers.emplace_back();
+					}
+					layers[0].settings.noiseType = noiseType;
+					layers[0].settings.noiseSeed = seed;
+					layers[0].settings.amplitude = amplitude;
+					layers[0].settings.frequency = frequency;
+					heightmap->SetLayers(layers);
+					ApplyLayerChanges(size);
+				};
+
 				if (amplitudeChanged || frequencyChanged) {
-					heightmap->Amplitude = amplitude;
-					heightmap->Frequency = frequency;
-					heightmap->GenerateHeightsUsingNoise(noiseType, heightmap->GetNoiseSeed());
-					heightmap->Update();
+					SetBaseLayer(heightmap->GetSize(), heightmap->GetNoiseSeed());
 				}
 
 				if (ImGui::Button("Generate Terrain")) {
-					if (oldTerrainSize != terrainSize) {
-						oldTerrainSize = terrainSize;
-						terrain = terrainFactory.GenerateTerrain(dataFactory, terrainSize, terrainSize * 2, terrain.GetTextureIDs(), noiseSeed);
-						water = waterFactory.GenerateWater(dataFactory, dudvMapTextureID, normalmapTextureID, terrainSize, displayWidth, displayHeight);
-						heightmap = terrain.GetHeightmap();
+					SetBaseLayer(float(terrainSize), noiseSeed);
+				}
+
+				if (terrainGenerator.IsBusy()) {
+					//the coarse levels are swapped in as previews while the finer ones are generated
+					ImGui::ProgressBar(terrainGenerator.GetProgress(), ImVec2(150.f, 0.f), terrainGenerator.GetLevel() == 0 ? "Generating" : "Refining");
+				}
+				else if (terrain.IsReplacing()) {
+					ImGui::ProgressBar(1.f, ImVec2(150.f, 0.f), "Uploading");
+				}
+
+				ImGui::PopItemWidth();
+			}
+			ImGui::End();
+
+			//layers stacked on the base noise, the base itself is set in the generation settings
+			ImGui::Begin("Terrain Layers"); {
+				ImGui::PushItemWidth(150);
+				static const char* blendModes[] = {
+					"Add",
+					"Subtract",
+					"Max",
+					"Min"
+				};
+
+				int removedLayer = -1;
+				for (int i = 1; i < heightmap->GetLayerCount(); i++) {
+					ImGui::PushID(i);
+					HeightmapLayerSettings settings = heightmap->GetLayerSettings(i);
+					bool changed = false;
+					ImGui::Text("Layer %d", i);
+					changed |= ImGui::Checkbox("Enabled", &settings.enabled);
+					changed |= ImGui::Combo("Noise Type", &settings.noiseType, noiseTypes, sizeof(noiseTypes) / sizeof(noiseTypes[0]));
+					changed |= ImGui::InputFloat("Seed", &settings.noiseSeed, 1.f, 10.f, "%.0f");
+					changed |= ImGui::SliderFloat("Frequency", &settings.frequency, 0.01f, 2.f);
+					changed |= ImGui::SliderFloat("Amplitude", &settings.amplitude, 0.f, 300.f);
+					int blendMode = int(settings.blendMode);
+					if (ImGui::Combo("Blend", &blendMode, blendModes, sizeof(blendModes) / sizeof(blendModes[0]))) {
+						settings.blendMode = LayerBlendMode(blendMode);
+						changed = true;
 					}
-					else {
-						heightmap->Amplitude = amplitude;
-						heightmap->Frequency = frequency;
-						heightmap->GenerateHeightsUsingNoise(noiseType, noiseSeed);
-						heightmap->Update();
+					changed |= ImGui::SliderFloat("Opacity", &settings.opacity, 0.f, 1.f);
+
+					bool stamp = settings.maskRadius > 0.f;
+					if (ImGui::Checkbox("Stamp", &stamp)) {
+						settings.maskRadius = stamp ? heightmap->GetSize() / 4.f : 0.f;
+						changed = true;
+					}
+					if (stamp) {
+						float size = heightmap->GetSize();
+						changed |= ImGui::SliderFloat("Stamp X", &settings.maskX, -size, size);
+						changed |= ImGui::SliderFloat("Stamp Z", &settings.maskZ, -size, size);
+						changed |= ImGui::SliderFloat("Stamp Radius", &settings.maskRadius, 1.f, size);
+						changed |= ImGui::SliderFloat("Stamp Falloff", &settings.maskFalloff, 0.f, 1.f);
+					}
+
+					if (changed) {
+						heightmap->SetLayerSettings(i, settings);
+						ApplyLayerChanges(heightmap->GetSize());
+					}
+					if (ImGui::Button("Remove")) {
+						removedLayer = i;
+					}
+					ImGui::Separator();
+					ImGui::PopID();
+				}
+				if (removedLayer > 0) {
+					heightmap->RemoveLayer(removedLayer);
+					ApplyLayerChanges(heightmap->GetSize());
+				}
+
+				//a heightmap that wasn't generated, like an imported one, has no base to stack layers on
+				ImGui::BeginDisabled(heightmap->GetLayerCount() == 0);
+				if (ImGui::Button("Add Layer")) {
+					HeightmapLayerSettings settings;
+					settings.noiseSeed = float(rand() % 10000);
+					settings.frequency = 0.5f;
+					settings.amplitude = 20.f;
+					if (heightmap->AddLayer(settings)) {
+						ApplyLayerChanges(heightmap->GetSize());
 					}
 				}
+				ImGui::EndDisabled();
 
 				ImGui::PopItemWidth();
 			}
@@ -393,17 +580,63 @@ int main()
 				static int brushType = 0;
 				ImGui::Combo("Brush Type", &brushType, brushTypes, sizeof(brushTypes) / sizeof(brushTypes[0]));
 
+				static const char* brushTools[] = {
+					"Raise/Lower",
+					"Smooth",
+					"Flatten",
+					"Noise",
+					"Terrace",
+					"Erode"
+				};
+				static int brushTool = 0;
+				ImGui::Combo("Tool", &brushTool, brushTools, sizeof(brushTools) / sizeof(brushTools[0]));
+				static BrushToolSettings toolSettings;
+				switch (BrushTool(brushTool)) {
+				case BrushTool::Smooth:
+					ImGui::SliderInt("Smooth Radius", &toolSettings.smoothRadius, 1, 32);
+					break;
+				case BrushTool::Noise:
+					ImGui::SliderFloat("Noise Frequency", &toolSettings.noiseFrequency, 0.005f, 0.5f);
+					ImGui::SliderFloat("Noise Amplitude", &toolSettings.noiseAmplitude, 0.f, 50.f);
+					break;
+				case BrushTool::Terrace:
+					ImGui::SliderFloat("Terrace Height", &toolSettings.terraceHeight, 1.f, 50.f);
+					ImGui::SliderFloat("Terrace Sharpness", &toolSettings.terraceSharpness, 0.f, 1.f);
+					break;
+				case BrushTool::Erode:
+					ImGui::SliderFloat("Talus Angle", &toolSettings.talusAngle, 5.f, 80.f);
+					break;
+				default:
+					break;
+				}
+
 				static float strength = .5f;
 				ImGui::SliderFloat("Strength", &strength, 0.f, 1.f);
 
 				static bool brushEnabled = true;
 				ImGui::Checkbox("Enable Brush", &brushEnabled);
 
+				//a stroke lasts for as long as a mouse button is held
+				if (!mouseLeft && !mouseRight) {
+					sculptHistory.EndStroke(*heightmap);
+				}
+
 				if (brushEnabled) {
 					float ndcX = (2.f * mouseX) / displayWidth - 1.f;
 					float ndcY = 1.f - (2.f * mouseY) / displayHeight;
 
-					glm::vec3 intersectionPoint = Raycaster::GetRaycastFromCameraToTerrain(camera.position, terrain, ndcX, ndcY, projectionMatrix, viewMatrix);
+					//the ray only has to be cast again when the mouse, the camera or the terrain moved
+					static glm::vec3 intersectionPoint = glm::vec3(std::numeric_limits<float>::max());
+					static glm::vec2 lastNdc = glm::vec2(std::numeric_limits<float>::max());
+					static glm::mat4 lastViewMatrix = glm::mat4(0.f);
+					static int lastTerrainRevision = -1;
+					if (lastNdc != glm::vec2(ndcX, ndcY) || lastViewMatrix != viewMatrix || lastTerrainRevision != terrain.GetRevision()) {
+						ProfileScope raycastScope("Raycast");
+						intersectionPoint = Raycaster::GetRaycastFromCameraToTerrain(camera.position, terrain, ndcX, ndcY, projectionMatrix, viewMatrix);
+						lastNdc = glm::vec2(ndcX, ndcY);
+						lastViewMatrix = viewMatrix;
+						lastTerrainRevision = terrain.GetRevision();
+					}
 
 					if (intersectionPoint.y != std::numeric_limits<float>::max()) {
 						if (!ImGui::GetIO().WantCaptureMouse) {
@@ -412,12 +645,32 @@ int main()
 							terrainShaderHandler.SetIndicatorRadius(sculptRadius);
 							terrainShaderHandler.Disable();
 
-							if (mouseLeft) {
+							BrushTool tool = BrushTool(brushTool);
+							if (tool == BrushTool::Raise && mouseLeft && !regenerating) {
+								profiler.BeginScope("Sculpt", false);
+								sculptHistory.RecordRegion(*heightmap, Sculptor::GetBrushRegion(*heightmap, intersectionPoint.x, intersectionPoint.z, sculptRadius));
 								Sculptor::Sculpt(heightmap, intersectionPoint.x, intersectionPoint.z, sculptRadius, strength * 90.f * deltaTime, brushType);
+								profiler.EndScope();
+								ProfileScope uploadScope("Upload", true);
 								terrain.Update();
 							}
-							else if (mouseRight) {
+							else if (tool == BrushTool::Raise && mouseRight && !regenerating) {
+								profiler.BeginScope("Sculpt", false);
+								sculptHistory.RecordRegion(*heightmap, Sculptor::GetBrushRegion(*heightmap, intersectionPoint.x, intersectionPoint.z, sculptRadius));
 								Sculptor::Sculpt(heightmap, intersectionPoint.x, intersectionPoint.z, sculptRadius, -strength * 90.f * deltaTime, brushType);
+								profiler.EndScope();
+								ProfileScope uploadScope("Upload", true);
+								terrain.Update();
+							}
+							//the other tools only have one direction, except for noise which the right button subtracts
+							else if (tool != BrushTool::Raise && (mouseLeft || (mouseRight && tool == BrushTool::Noise)) && !regenerating) {
+								profiler.BeginScope("Sculpt", false);
+								sculptHistory.RecordRegion(*heightmap, Sculptor::GetBrushRegion(*heightmap, intersectionPoint.x, intersectionPoint.z, sculptRadius));
+								float amount = std::min(strength * 10.f * deltaTime, 1.f);
+								Sculptor::ApplyTool(*heightmap, tool, intersectionPoint.x, intersectionPoint.z, sculptRadius,
+									mouseLeft ? amount : -amount, brushType, toolSettings);
+								profiler.EndScope();
+								ProfileScope uploadScope("Upload", true);
 								terrain.Update();
 							}
 						}
@@ -429,6 +682,89 @@ int main()
 					terrainShaderHandler.Disable();
 				}
 
+				ImGui::Separator();
+				ImGui::BeginDisabled(!sculptHistory.CanUndo() || regenerating);
+				if (ImGui::Button("Undo") && sculptHistory.Undo(*heightmap)) {
+					terrain.Update();
+				}
+				ImGui::EndDisabled();
+				ImGui::SameLine();
+				ImGui::BeginDisabled(!sculptHistory.CanRedo() || regenerating);
+				if (ImGui::Button("Redo") && sculptHistory.Redo(*heightmap)) {
+					terrain.Update();
+				}
+				ImGui::EndDisabled();
+
+				static int historyBudgetMB = int(sculptHistory.GetMemoryBudget() / (1024 * 1024));
+				if (ImGui::SliderInt("History Budget (MB)", &historyBudgetMB, 1, 1024)) {
+					sculptHistory.SetMemoryBudget(size_t(historyBudgetMB) * 1024 * 1024);
+				}
+				ImGui::Text("History: %d undo, %d redo, %.2f MB", sculptHistory.GetUndoCount(), sculptHistory.GetRedoCount(),
+					sculptHistory.GetMemoryUsage() / (1024.f * 1024.f));
+
+				ImGui::PopItemWidth();
+			}
+			ImGui::End();
+
+			ImGui::Begin("Erosion"); {
+				ImGui::PushItemWidth(150);
+				static ErosionSettings erosionSettings;
+				static bool eroding = false;
+				static int iterationsPerFrame = 1;
+				//the heights erosion last wrote, anything else that changed them since starts the simulation over from them
+				static std::shared_ptr<Heightmap> erodedHeightmap;
+				static int erodedRevision = -1;
+
+				bool settingsChanged = false;
+				int seed = int(erosionSettings.seed);
+				if (ImGui::InputInt("Seed", &seed)) {
+					erosionSettings.seed = uint32_t(seed);
+					erodedRevision = -1; // a new seed starts over
+				}
+				ImGui::SliderInt("Iterations Per Frame", &iterationsPerFrame, 1, 20);
+
+				settingsChanged |= ImGui::Checkbox("Hydraulic", &erosionSettings.hydraulic);
+				if (erosionSettings.hydraulic) {
+					settingsChanged |= ImGui::SliderInt("Droplets", &erosionSettings.dropletsPerIteration, 256, 65536);
+					settingsChanged |= ImGui::SliderInt("Droplet Lifetime", &erosionSettings.maxLifetime, 1, 64);
+					settingsChanged |= ImGui::SliderInt("Erosion Radius", &erosionSettings.erosionRadius, 1, 8);
+					settingsChanged |= ImGui::SliderFloat("Inertia", &erosionSettings.inertia, 0.f, 1.f);
+					settingsChanged |= ImGui::SliderFloat("Sediment Capacity", &erosionSettings.sedimentCapacity, 0.f, 16.f);
+					settingsChanged |= ImGui::SliderFloat("Erode Speed", &erosionSettings.erodeSpeed, 0.f, 1.f);
+					settingsChanged |= ImGui::SliderFloat("Deposit Speed", &erosionSettings.depositSpeed, 0.f, 1.f);
+					settingsChanged |= ImGui::SliderFloat("Evaporate Speed", &erosionSettings.evaporateSpeed, 0.f, 0.5f);
+				}
+				settingsChanged |= ImGui::Checkbox("Thermal", &erosionSettings.thermal);
+				if (erosionSettings.thermal) {
+					settingsChanged |= ImGui::SliderFloat("Talus Angle", &erosionSettings.talusAngle, 5.f, 80.f);
+					settingsChanged |= ImGui::SliderFloat("Thermal Rate", &erosionSettings.thermalRate, 0.f, 1.f);
+					ImGui::Text("Thermal erosion changes the whole map every iteration");
+				}
+				if (settingsChanged) {
+					erosion.SetSettings(erosionSettings);
+				}
+
+				if (ImGui::Button(eroding ? "Pause" : "Erode")) {
+					eroding = !eroding;
+				}
+				ImGui::SameLine();
+				ImGui::Text("Iteration %d", erosion.GetIteration());
+
+				//erosion runs on the heightmap being edited, which is only drawn once regeneration finished
+				if (eroding && !regenerating) {
+					if (erodedHeightmap != heightmap || erodedRevision != terrain.GetRevision()) {
+						erosion.Begin(*heightmap, erosionSettings);
+						erodedHeightmap = heightmap;
+					}
+					profiler.BeginScope("Erosion", false);
+					erosion.Step(*heightmap, iterationsPerFrame);
+					profiler.EndScope();
+					ProfileScope uploadScope("Upload", true);
+					terrain.Update();
+					erodedRevision = terrain.GetRevision();
+					sculptHistory.Clear(); // the history only holds the changes of strokes
+				}
+
 				ImGui::PopItemWidth();
 			}
 			ImGui::End();
@@ -437,19 +773,31 @@ int main()
 			{
 				ImGui::PushItemWidth(150);
 
-				static bool isExporting = false;
-				static float progress = 0.f;
+				static std::atomic<bool> isExporting = false;
+				static std::atomic<float> progress = 0.f;
+
+				static const char* exportFormats[] = {
+					"Wavefront (.obj)",
+					"Binary PLY (.ply)",
+					"Binary STL (.stl)"
+				};
+				static int exportFormat = 0;
+				ImGui::Combo("Format", &exportFormat, exportFormats, sizeof(exportFormats) / sizeof(exportFormats[0]));
+				ExportFormat format = ExportFormat(exportFormat);
 
-				if (ImGui::Button("Export to .obj")) {
-					const char* filterPatterns[] = { "*.obj" };
+				if (ImGui::Button("Export") && !isExporting) {
+					std::string extension = TerrainExporter::GetExtension(format);
+					std::string filterPattern = "*." + extension;
+					std::string defaultPath = "terrain." + extension;
+					const char* filterPatterns[] = { filterPattern.c_str() };
 
 					//open save file dialog using tiny file dialog
 					const char* filePath = tinyfd_saveFileDialog(
-						"Export Wavefront File",
-						"terrain.obj",
+						"Export Terrain",
+						defaultPath.c_str(),
 						1,
 						filterPatterns,
-						"Wavefront File"
+						exportFormats[exportFormat]
 					);
 
 					if (filePath) {
@@ -458,68 +806,21 @@ int main()
 
 						ImGui::OpenPopup("Exporting");
 
-						//create a thread for the exporting the heightmap
-						std::thread([&]() {
-							std::ostringstream output;
-
-							std::vector<int> indices = terrain.GetIndices();
-
-							std::ofstream file(filePath);
-							if (!file.is_open()) {
-								std::cerr << "Error trying to open file for writing: " << filePath << std::endl;
-								isExporting = false;
-								return 0;
-							}
-
-							float step = (2.f * terrainSize) / (terrainResolution - 1);
-
-							//for progress bar
-							int totalSteps = terrainResolution * terrainResolution + indices.size() / 3;
-							int currentStep = 0;
-
-							for (int z = 0; z < terrainResolution; z++) {
-								for (int x = 0; x < terrainResolution; ++x) {
-									float posX = -terrainSize + x * step;
-									float posZ = -terrainSize + z * step;
-									float posY = heightmap->GetHeight(x, z); //height from heightmap
-									output << "v " << posX << " " << posY << " " << posZ << "\n";
-
-									float u = float(x) / (terrainResolution - 1);
-									float v = float(z) / (terrainResolution - 1);
-									output << "vt " << u << " " << v << "\n";
-
-									//progress update
-									currentStep++;
-									progress = float(currentStep) / totalSteps;
-								}
-							}
-
-							for (int i = 0; i < indices.size(); i += 3) {
-								int corner1 = indices[i] + 1;
-								int corner2 = indices[i + 1] + 1;
-								int corner3 = indices[i + 2] + 1;
-
-								output << "f " << corner1 << "/" << corner1 << " "
-									           << corner2 << "/" << corner2 << " "
-									           << corner3 << "/" << corner3 << "\n";
-
-								//progress update
-								currentStep++;
-								progress = float(currentStep) / totalSteps;
-							}
-
-							file << output.str();
-							file.close();
-
+						//export on a separate thread. the dialog's path buffer is reused, so the thread gets its own copy. so do
+						//the heights, erosion keeps changing them while the file is written
+						std::shared_ptr<Heightmap> exported = std::make_shared<Heightmap>(heightmap->GetSize(), int(heightmap->GetResolution()));
+						exported->SetHeights(heightmap->GetHeightField().GetData(), heightmap->GetMinHeight(), heightmap->GetMaxHeight());
+						std::thread([exported, path = std::string(filePath), format]() {
+							TerrainExporter::Export(*exported, path, format, progress);
 							isExporting = false;
-							}).detach();
+						}).detach();
 					}
 				}
 
 				//catch open popup signal from imgui. if caught, start progress bar
 				if (ImGui::BeginPopupModal("Exporting", nullptr)) {
 					if (isExporting) {
-						ImGui::Text("Exporting terrain to .obj...");
+						ImGui::Text("Exporting terrain to .%s...", TerrainExporter::GetExtension(format));
 						ImGui::ProgressBar(progress, ImVec2(ImGui::GetWindowWidth() - 20.f, 0.f));
 					}
 					else {
@@ -535,6 +836,81 @@ int main()
 			}
 			ImGui::End();
 
+			ImGui::Begin("Heightmap Files"); {
+				ImGui::PushItemWidth(150);
+
+				//a loaded heightmap brings its own size, so the terrain and water are rebuilt around it like after a resize
+				auto ReplaceHeightmap = [&](std::shared_ptr<Heightmap> loadedHeightmap) {
+					if (!loadedHeightmap) {
+						return;
+					}
+					terrainGenerator.Cancel();
+					terrainSize = int(loadedHeightmap->GetSize());
+					terrain = terrainFactory.GenerateTerrain(dataFactory, loadedHeightmap, terrain.GetTextureIDs());
+					water = waterFactory.GenerateWater(dataFactory, dudvMapTextureID, normalmapTextureID, loadedHeightmap->GetSize(), displayWidth, displayHeight);
+					heightmap = loadedHeightmap;
+					amplitude = heightmap->Amplitude;
+					frequency = heightmap->Frequency;
+					sculptHistory.Clear();
+				};
+
+				const char* nativeFilter[] = { "*.tsh" };
+				if (ImGui::Button("Save Heightmap")) {
+					const char* filePath = tinyfd_saveFileDialog("Save Heightmap", "terrain.tsh", 1, nativeFilter, "TerraSim Heightmap (.tsh)");
+					if (filePath) {
+						HeightmapFile::SaveNative(*heightmap, filePath);
+					}
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Load Heightmap")) {
+					const char* filePath = tinyfd_openFileDialog("Load Heightmap", "", 1, nativeFilter, "TerraSim Heightmap (.tsh)", 0);
+					if (filePath) {
+						ReplaceHeightmap(HeightmapFile::LoadNative(filePath));
+					}
+				}
+
+				ImGui::Separator();
+
+				//16 bit files only store the shape of the terrain, imported values are spread over this height range
+				static float importMinHeight = 0.f;
+				static float importMaxHeight = heightmap->Amplitude;
+				ImGui::InputFloat("Import Min Height", &importMinHeight);
+				ImGui::InputFloat("Import Max Height", &importMaxHeight);
+
+				const char* pngFilter[] = { "*.png" };
+				const char* rawFilter[] = { "*.raw", "*.r16" };
+				if (ImGui::Button("Import PNG16")) {
+					const char* filePath = tinyfd_openFileDialog("Import 16 Bit PNG", "", 1, pngFilter, "16 bit PNG (.png)", 0);
+					if (filePath) {
+						ReplaceHeightmap(HeightmapFile::ImportPng16(filePath, importMinHeight, importMaxHeight));
+					}
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Import RAW16")) {
+					const char* filePath = tinyfd_openFileDialog("Import RAW16", "", 2, rawFilter, "16 bit RAW (.raw, .r16)", 0);
+					if (filePath) {
+						ReplaceHeightmap(HeightmapFile::ImportRaw16(filePath, importMinHeight, importMaxHeight));
+					}
+				}
+
+				if (ImGui::Button("Export PNG16")) {
+					const char* filePath = tinyfd_saveFileDialog("Export 16 Bit PNG", "terrain.png", 1, pngFilter, "16 bit PNG (.png)");
+					if (filePath) {
+						HeightmapFile::ExportPng16(*heightmap, filePath);
+					}
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Export RAW16")) {
+					const char* filePath = tinyfd_saveFileDialog("Export RAW16", "terrain.raw", 2, rawFilter, "16 bit RAW (.raw, .r16)");
+					if (filePath) {
+						HeightmapFile::ExportRaw16(*heightmap, filePath);
+					}
+				}
+
+				ImGui::PopItemWidth();
+			}
+			ImGui::End();
+
 			ImGui::Begin("Texture Settings"); {
 				ImGui::PushItemWidth(150);
 
@@ -550,7 +926,7 @@ int main()
 
 					if (filePath) {
 						// Load the new texture
-						GLuint newTextureID = dataFactory.LoadTexture(filePath); // Assumes you have a function to load textures
+						GLuint newTextureID = textureLoader.LoadTexture(dataFactory, filePath);
 						textures[index] = newTextureID;
 
 						// Update the texture in your terrain object or relevant structure
@@ -593,9 +969,55 @@ int main()
 			}
 			ImGui::End();
 
+			ImGui::Begin("Profiler"); {
+				//the breakdown trails the current frame by a few frames, until the GPU has finished its queries
+				const ProfilerFrame& profiledFrame = profiler.GetLastFrame();
+				ImGui::Text("Frame: CPU %.2f ms, GPU %.2f ms", profiledFrame.cpuTime, profiledFrame.gpuTime);
+				ImGui::PlotLines("CPU (ms)", profiler.GetCpuHistory().data(), int(profiler.GetCpuHistory().size()), 0, nullptr, 0.f, 33.f, ImVec2(240.f, 50.f));
+				ImGui::PlotLines("GPU (ms)", profiler.GetGpuHistory().data(), int(profiler.GetGpuHistory().size()), 0, nullptr, 0.f, 33.f, ImVec2(240.f, 50.f));
+
+				ImGui::Separator();
+				for (const ProfilerScopeTiming& scope : profiledFrame.scopes) {
+					if (scope.gpuTime >= 0.0) {
+						ImGui::Text("%*s%-12s CPU %6.2f ms  GPU %6.2f ms", scope.depth * 2, "", scope.name, scope.cpuTime, scope.gpuTime);
+					}
+					else {
+						ImGui::Text("%*s%-12s CPU %6.2f ms", scope.depth * 2, "", scope.name, scope.cpuTime);
+					}
+				}
+
+				for (const ProfilerCounter& counter : profiledFrame.counters) {
+					ImGui::Text("%-14s %8.1f", counter.name, counter.value);
+				}
+
+				ImGui::Separator();
+				ProgramCacheStats programCacheStats = ShaderHandler::GetProgramCacheStats();
+				ImGui::Text("Startup %.1f ms, %d of %d programs cached", profiler.GetStartupTime(), programCacheStats.loaded,
+					programCacheStats.loaded + programCacheStats.compiled);
+				for (const ProfilerStartupPhase& phase : profiler.GetStartupPhases()) {
+					ImGui::Text("  %-14s %8.1f ms", phase.name, phase.time);
+				}
+
+				ImGui::Separator();
+				if (ImGui::Button("Save Chrome Trace")) {
+					const char* traceFilter[] = { "*.json" };
+					const char* filePath = tinyfd_saveFileDialog("Save Chrome Trace", "terrasim_trace.json", 1, traceFilter, "Chrome Trace (.json)");
+					if (filePath) {
+						profiler.WriteChromeTrace(filePath);
+					}
+				}
+				ImGui::SameLine();
+				ImGui::Text("keeps the last %d frames", int(Profiler::TRACE_FRAMES));
+			}
+			ImGui::End();
+
 			ImGui::Begin("Debug"); {
 
 				ImGui::Text("FPS: %f", fps);
+				const TerrainRenderStats& terrainStats = renderer.GetTerrainStats();
+				ImGui::Text("Terrain Patches Drawn: %d", terrainStats.patchesDrawn);
+				ImGui::Text("Terrain Nodes Culled: %d", terrainStats.nodesCulled);
+				ImGui::Text("Terrain Draw Calls: %d", terrainStats.drawCalls);
 				ImGui::Text("Camera X: %f", camera.position.x);
 				ImGui::Text("Camera Y: %f", camera.position.y);
 				ImGui::Text("Camera Z: %f", camera.position.z);
@@ -614,12 +1036,46 @@ int main()
 		}
 
 		//render the new imgui frame
+		profiler.BeginScope("ImGui", true);
 		renderer.RenderImGuiFrame();
+		profiler.EndScope();
+
+		profiler.BeginScope("Swap", false);
 		renderer.Update();
+		profiler.EndScope();
+
+		//the driver finishes what the startup queued up during the first frame
+		if (!startupTimed) {
+			profiler.EndStartupPhase("First frame");
+			ProgramCacheStats programCacheStats = ShaderHandler::GetProgramCacheStats();
+			printf("Startup took %.1f ms, %d of %d shader programs loaded from the cache\n", profiler.GetStartupTime(),
+				programCacheStats.loaded, programCacheStats.loaded + programCacheStats.compiled);
+			for (const ProfilerStartupPhase& phase : profiler.GetStartupPhases()) {
+				printf("  %-14s %8.1f ms\n", phase.name, phase.time);
+			}
+			startupTimed = true;
+		}
+
+		UploadRing& uploadRing = UploadRing::Get();
+		uploadRing.EndFrame();
+		profiler.SetCounter("Uploaded (KB)", uploadRing.GetLastFrameStats().bytes / 1024.0);
+		profiler.SetCounter("Upload stalls", uploadRing.GetLastFrameStats().stalls);
+		UniformStats uniformStats = ShaderHandler::TakeUniformStats();
+		profiler.SetCounter("Uniform calls", uniformStats.uploads);
+		profiler.SetCounter("Uniform calls skipped", uniformStats.skipped);
+		GLStateStats stateStats = GLState::Get().TakeStats();
+		profiler.SetCounter("State calls", stateStats.calls);
+		profiler.SetCounter("State calls skipped", stateStats.skipped);
+		profiler.SetCounter("Textures loading", double(textureLoader.GetPendingCount()));
+		profiler.EndFrame();
 
 
 	}
 	terrainShaderHandler.Destroy();
+	frameUniformBuffer.Destroy();
+	lightUniformBuffer.Destroy();
+	Profiler::Get().Destroy();
+	UploadRing::Get().Destroy();
 	dataFactory.DeleteDataObjects();
 	renderer.Destroy();
 
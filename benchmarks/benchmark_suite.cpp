@@ -0,0 +1,479 @@
+// Benchmarks the CPU hot paths of the editor: noise generation, amplitude rescaling, sculpting, brush tools, erosion,
+// brush raycasts, terrain building and mesh export. Runs without a window or GL context, see CMakeLists.txt in this folder.
+//
+//   terrasim_benchmarks [--sizes 256,512,1024,2000] [--repetitions 3] [--filter name] [--json results.json]
+//
+// "sculpt_ref" runs the per texel sculpt loop the falloff table replaced, next to "sculpt" for comparison.
+//
+// Every case reports the time per item (texel or ray), the items per second, bytes per second for cases that write
+// files, and the peak resident memory while the case ran. --json writes the same rows for regression tracking.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "../terrain/heightmap.h"
+#include "../terrain/terrain.h"
+#include "../terrain/sculptor.hpp"
+#include "../terrain/erosion.h"
+#include "../raycasting/raycaster.hpp"
+#include "../exporting/terrain_exporter.h"
+
+struct Options {
+	std::vector<int> sizes = { 256, 512, 1024, 2000 };
+	int repetitions = 3;
+	std::string filter;
+	std::string jsonPath;
+};
+
+struct BenchmarkResult {
+	std::string name;
+	std::string variant;
+	int size;
+	const char* itemUnit;
+	double itemCount;  // items processed by one repetition
+	double seconds;    // best repetition
+	double byteCount;  // bytes written by one repetition, 0 if the case doesn't write
+	long long peakRssKiB;
+};
+
+//peak resident memory is tracked per case. linux can reset the high water mark, elsewhere it's the peak of the process
+static void ResetPeakRss() {
+#ifdef __linux__
+	std::ofstream clearRefs("/proc/self/clear_refs");
+	clearRefs << "5";
+#endif
+}
+
+static long long GetPeakRssKiB() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return (long long)(counters.PeakWorkingSetSize / 1024);
+	}
+	return 0;
+#elif defined(__linux__)
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.compare(0, 6, "VmHWM:") == 0) {
+			return std::atoll(line.c_str() + 6);
+		}
+	}
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (long long)(usage.ru_maxrss / 1024); //bytes on macOS
+#endif
+}
+
+template<typename Function>
+static double MeasureSeconds(Function function) {
+	auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+class BenchmarkRunner {
+public:
+	explicit BenchmarkRunner(const Options& options) : m_options(options) {
+		std::printf("%-14s %-18s %6s %14s %14s %12s %12s\n", "benchmark", "variant", "size", "ns/item", "items/s", "MB/s", "peak RSS MB");
+	}
+
+	bool IsEnabled(const std::string& name) const {
+		return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+	}
+
+	// runs the case the configured number of times and keeps the best time, setup has to happen outside of it
+	template<typename Function>
+	void Run(const std::string& name, const std::string& variant, int size, const char* itemUnit, double itemCount, Function function) {
+		ResetPeakRss();
+		BenchmarkResult result = { name, variant, size, itemUnit, itemCount, DBL_MAX, 0.0, 0 };
+		for (int repetition = 0; repetition < m_options.repetitions; repetition++) {
+			double byteCount = 0.0;
+			result.seconds = std::min(result.seconds, MeasureSeconds([&]() { byteCount = function(); }));
+			result.byteCount = byteCount;
+		}
+		result.peakRssKiB = GetPeakRssKiB();
+		Print(result);
+		m_results.push_back(result);
+	}
+
+	bool WriteJson(const std::string& filePath) const {
+		std::ofstream file(filePath);
+		if (!file.is_open()) {
+			std::fprintf(stderr, "Error trying to open file for writing: %s\n", filePath.c_str());
+			return false;
+		}
+
+		file << "{\n  \"repetitions\": " << m_options.repetitions << ",\n  \"results\": [\n";
+		for (size_t i = 0; i < m_results.size(); i++) {
+			const BenchmarkResult& result = m_results[i];
+			char line[512];
+			std::snprintf(line, sizeof(line),
+				"    {\"benchmark\": \"%s\", \"variant\": \"%s\", \"size\": %d, \"item\": \"%s\", \"items\": %.0f, "
+				"\"seconds\": %.9f, \"ns_per_item\": %.3f, \"items_per_second\": %.1f, \"bytes_per_second\": %.1f, \"peak_rss_kib\": %lld}%s\n",
+				result.name.c_str(), result.variant.c_str(), result.size, result.itemUnit, result.itemCount,
+				result.seconds, GetNsPerItem(result), result.itemCount / result.seconds, result.byteCount / result.seconds,
+				result.peakRssKiB, i + 1 < m_results.size() ? "," : "");
+			file << line;
+		}
+		file << "  ]\n}\n";
+
+		file.close();
+		if (file.fail()) {
+			std::fprintf(stderr, "Error writing to file: %s\n", filePath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+private:
+	static double GetNsPerItem(const BenchmarkResult& result) {
+		return result.seconds / result.itemCount * 1e9;
+	}
+
+	void Print(const BenchmarkResult& result) const {
+		char throughput[32] = "-";
+		if (result.byteCount > 0.0) {
+			std::snprintf(throughput, sizeof(throughput), "%.1f", result.byteCount / result.seconds / 1e6);
+		}
+		std::printf("%-14s %-18s %6d %14.2f %14.0f %12s %12.1f\n", result.name.c_str(), result.variant.c_str(), result.size,
+			GetNsPerItem(result), result.itemCount / result.seconds, throughput, result.peakRssKiB / 1024.0);
+		std::fflush(stdout);
+	}
+
+	const Options& m_options;
+	std::vector<BenchmarkResult> m_results;
+};
+
+static void BenchmarkNoise(BenchmarkRunner& runner, std::shared_ptr<Heightmap> heightmap, int size) {
+	const char* noiseTypes[] = { "simplex_fractal", "fbm_ridged" };
+	double texelCount = double(heightmap->GetResolution()) * heightmap->GetResolution();
+	for (int noiseType = 0; noiseType < 2; noiseType++) {
+		runner.Run("noise", noiseTypes[noiseType], size, "texel", texelCount, [&]() {
+			heightmap->GenerateHeightsUsingNoise(noiseType, 1.f);
+			return 0.0;
+		});
+	}
+}
+
+//amplitude changes on generated heights the way the amplitude slider applies them, with and without a sculpt layer on top
+static void BenchmarkRescale(BenchmarkRunner& runner, std::shared_ptr<Heightmap> heightmap, int size) {
+	double texelCount = double(heightmap->GetResolution()) * heightmap->GetResolution();
+	int noiseType = 1;
+	heightmap->GenerateHeightsUsingNoise(noiseType, 1.f);
+	auto ToggleAmplitude = [&]() {
+		HeightmapLayerSettings settings = heightmap->GetLayerSettings(0);
+		settings.amplitude = settings.amplitude == 80.f ? 60.f : 80.f;
+		heightmap->SetLayerSettings(0, settings);
+		heightmap->UpdateLayers();
+		return 0.0;
+	};
+	runner.Run("rescale", "noise_only", size, "texel", texelCount, ToggleAmplitude);
+
+	Sculptor::Sculpt(heightmap, 0.f, 0.f, 10.f, .5f, 0);
+	runner.Run("rescale", "sculpted", size, "texel", texelCount, ToggleAmplitude);
+}
+
+//the sculpt loop before the falloff table: distance, curve and bounds checked SetHeight per texel. kept as the baseline
+//the "sculpt" case is compared against
+static void SculptPerTexel(std::shared_ptr<Heightmap> heightmap, float pointX, float pointZ, float radius, float strength, int brushType) {
+	float minRadius = radius / 3;
+	float heightmapSize = heightmap->GetSize();
+	int heightmapResolution = heightmap->GetResolution();
+	int gridX = int((pointX / heightmapSize + 1.f) / 2.f * heightmapResolution);
+	int gridZ = int((pointZ / heightmapSize + 1.f) / 2.f * heightmapResolution);
+
+	for (int z = int(gridZ - radius); z <= int(gridZ + radius); z++) {
+		for (int x = int(gridX - radius); x <= int(gridX + radius); x++) {
+			if (x < 0 || x >= heightmapResolution || z < 0 || z >= heightmapResolution) {
+				continue;
+			}
+			float worldX = ((float(x) / heightmapResolution) * 2.f - 1.f) * heightmapSize;
+			float worldZ = ((float(z) / heightmapResolution) * 2.f - 1.f) * heightmapSize;
+			float distance = std::sqrt((worldX - pointX) * (worldX - pointX) + (worldZ - pointZ) * (worldZ - pointZ));
+			if (distance > radius) {
+				continue;
+			}
+
+			float intensity = 1.f;
+			if (brushType == 0) {
+				intensity = Sculptor::Step(distance, radius, minRadius);
+			}
+			if (brushType == 1) {
+				intensity = Sculptor::LinearFalloff(distance, radius, minRadius);
+			}
+			if (brushType == 2) {
+				intensity = Sculptor::LinearSmoothstep(distance, radius, minRadius);
+			}
+			if (brushType == 3) {
+				intensity = Sculptor::Polynomial(distance, radius, minRadius);
+			}
+			if (brushType == 4) {
+				intensity = Sculptor::Logarithmic(distance, radius, minRadius);
+			}
+			heightmap->SetHeight(x, z, heightmap->GetHeight(x, z) + strength * intensity);
+		}
+	}
+}
+
+//strokes at fixed random points away from the edges, so every application covers the whole brush
+static void BenchmarkSculpt(BenchmarkRunner& runner, std::shared_ptr<Heightmap> heightmap, int size) {
+	const char* brushTypes[] = { "step", "linear", "smoothstep", "polynomial", "logarithmic" };
+	const float radii[] = { 5.f, 20.f, 50.f, 100.f };
+
+	for (float radius : radii) {
+		if (radius * 2.f >= heightmap->GetSize()) {
+			continue;
+		}
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-heightmap->GetSize() + radius, heightmap->GetSize() - radius);
+		std::vector<glm::vec2> points(256);
+		for (glm::vec2& point : points) {
+			point = glm::vec2(position(random), position(random));
+		}
+
+		//the loop visits the square around the brush, so that is the work per application
+		int side = 2 * int(radius) + 1;
+		int applications = std::max(int(4e6 / (double(side) * side)), 16);
+		for (int brushType = 0; brushType < 5; brushType++) {
+			std::string variant = std::string(brushTypes[brushType]) + "_r" + std::to_string(int(radius));
+			runner.Run("sculpt", variant, size, "texel", double(applications) * side * side, [&]() {
+				for (int i = 0; i < applications; i++) {
+					const glm::vec2& point = points[i % points.size()];
+					Sculptor::Sculpt(heightmap, point.x, point.y, radius, (i & 1) ? .01f : -.01f, brushType);
+				}
+				return 0.0;
+			});
+			runner.Run("sculpt_ref", variant, size, "texel", double(applications) * side * side, [&]() {
+				for (int i = 0; i < applications; i++) {
+					const glm::vec2& point = points[i % points.size()];
+					SculptPerTexel(heightmap, point.x, point.y, radius, (i & 1) ? .01f : -.01f, brushType);
+				}
+				return 0.0;
+			});
+		}
+	}
+}
+
+//the tools with kernels, at the radii big brushes are used with. one application per texel of the square around the brush
+static void BenchmarkBrushTools(BenchmarkRunner& runner, std::shared_ptr<Heightmap> heightmap, int size) {
+	const char* toolNames[] = { "smooth", "flatten", "noise", "terrace", "erode" };
+	const BrushTool tools[] = { BrushTool::Smooth, BrushTool::Flatten, BrushTool::Noise, BrushTool::Terrace, BrushTool::Erode };
+	const float radii[] = { 50.f, 200.f };
+	BrushToolSettings settings;
+
+	for (float radius : radii) {
+		if (radius * 2.f >= heightmap->GetSize()) {
+			continue;
+		}
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-heightmap->GetSize() + radius, heightmap->GetSize() - radius);
+		std::vector<glm::vec2> points(64);
+		for (glm::vec2& point : points) {
+			point = glm::vec2(position(random), position(random));
+		}
+
+		int side = 2 * int(radius) + 1;
+		int applications = std::max(int(4e6 / (double(side) * side)), 8);
+		for (int tool = 0; tool < 5; tool++) {
+			std::string variant = std::string(toolNames[tool]) + "_r" + std::to_string(int(radius));
+			runner.Run("brush_tool", variant, size, "texel", double(applications) * side * side, [&]() {
+				for (int i = 0; i < applications; i++) {
+					const glm::vec2& point = points[i % points.size()];
+					Sculptor::ApplyTool(*heightmap, tools[tool], point.x, point.y, radius, .5f, 2, settings);
+				}
+				return 0.0;
+			});
+		}
+	}
+}
+
+//one iteration of each kind of erosion, including writing the heights back like every frame in the editor
+static void BenchmarkErosion(BenchmarkRunner& runner, std::shared_ptr<Heightmap> heightmap, int size) {
+	ErosionSimulator erosion;
+	ErosionSettings settings;
+	settings.thermal = false;
+	erosion.Begin(*heightmap, settings);
+	runner.Run("erosion", "hydraulic", size, "droplet", settings.dropletsPerIteration, [&]() {
+		erosion.Step(*heightmap, 1);
+		return 0.0;
+	});
+
+	settings.hydraulic = false;
+	settings.thermal = true;
+	erosion.SetSettings(settings);
+	double texelCount = double(heightmap->GetResolution()) * heightmap->GetResolution();
+	runner.Run("erosion", "thermal", size, "texel", texelCount, [&]() {
+		erosion.Step(*heightmap, 1);
+		return 0.0;
+	});
+}
+
+static Terrain BuildTerrain(std::shared_ptr<Heightmap> heightmap) {
+	//everything a terrain needs on the CPU. the patch mesh, heightmap texture and shadowmap are GL objects and stay empty
+	return Terrain(Model(), heightmap, HeightmapTexture(), Shadowmap(), std::vector<GLuint>(), TerrainQuadtree(heightmap->GetSize(), int(heightmap->GetResolution())));
+}
+
+static void BenchmarkTerrainBuild(BenchmarkRunner& runner, std::shared_ptr<Heightmap> heightmap, int size) {
+	double texelCount = double(heightmap->GetResolution()) * heightmap->GetResolution();
+	runner.Run("terrain_build", "quadtree_pyramid", size, "texel", texelCount, [&]() {
+		Terrain terrain = BuildTerrain(heightmap);
+		return 0.0;
+	});
+}
+
+//brush rays from random cameras above the terrain through random points of the screen
+static void BenchmarkRaycast(BenchmarkRunner& runner, std::shared_ptr<Heightmap> heightmap, int size) {
+	Terrain terrain = BuildTerrain(heightmap);
+	glm::mat4 projectionMatrix = glm::perspective(glm::radians(60.f), 16.f / 9.f, 10.f, 5000.f);
+
+	struct Ray {
+		glm::vec3 cameraPosition;
+		glm::mat4 viewMatrix;
+		float ndcX, ndcY;
+	};
+	const int rayCount = 20000;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-heightmap->GetSize(), heightmap->GetSize());
+	std::uniform_real_distribution<float> altitude(5.f, 150.f);
+	std::uniform_real_distribution<float> ndc(-1.f, 1.f);
+	std::vector<Ray> rays(rayCount);
+	for (Ray& ray : rays) {
+		ray.cameraPosition = glm::vec3(position(random), heightmap->GetMaxHeight() + altitude(random), position(random));
+		glm::vec3 target = glm::vec3(position(random), heightmap->GetMinHeight(), position(random));
+		ray.viewMatrix = glm::lookAt(ray.cameraPosition, target, glm::vec3(0.f, 1.f, 0.f));
+		ray.ndcX = ndc(random);
+		ray.ndcY = ndc(random);
+	}
+
+	int hits = 0;
+	runner.Run("raycast", "camera_to_terrain", size, "ray", rayCount, [&]() {
+		hits = 0;
+		for (const Ray& ray : rays) {
+			glm::vec3 hit = Raycaster::GetRaycastFromCameraToTerrain(ray.cameraPosition, terrain, ray.ndcX, ray.ndcY, projectionMatrix, ray.viewMatrix);
+			hits += hit.y != std::numeric_limits<float>::max();
+		}
+		return 0.0;
+	});
+}
+
+static void BenchmarkExport(BenchmarkRunner& runner, std::shared_ptr<Heightmap> heightmap, int size) {
+	const char* formatNames[] = { "obj", "ply", "stl" };
+	double texelCount = double(heightmap->GetResolution()) * heightmap->GetResolution();
+	std::filesystem::path filePath = std::filesystem::temp_directory_path() / "terrasim_benchmark_export";
+
+	for (int format = 0; format < 3; format++) {
+		runner.Run("export", formatNames[format], size, "texel", texelCount, [&]() {
+			std::atomic<float> progress = 0.f;
+			if (!TerrainExporter::Export(*heightmap, filePath.string(), ExportFormat(format), progress)) {
+				return 0.0;
+			}
+			return double(std::filesystem::file_size(filePath));
+		});
+	}
+	std::error_code error;
+	std::filesystem::remove(filePath, error);
+}
+
+static bool ParseOptions(int argc, char** argv, Options& options) {
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (argument == "--sizes" && hasValue) {
+			options.sizes.clear();
+			std::string list = argv[++i];
+			size_t start = 0;
+			while (start < list.size()) {
+				size_t end = list.find(',', start);
+				if (end == std::string::npos) {
+					end = list.size();
+				}
+				int size = std::atoi(list.substr(start, end - start).c_str());
+				if (size < 16) {
+					std::fprintf(stderr, "Invalid size in --sizes: %s\n", list.c_str());
+					return false;
+				}
+				options.sizes.push_back(size);
+				start = end + 1;
+			}
+		}
+		else if (argument == "--repetitions" && hasValue) {
+			options.repetitions = std::max(std::atoi(argv[++i]), 1);
+		}
+		else if (argument == "--filter" && hasValue) {
+			options.filter = argv[++i];
+		}
+		else if (argument == "--json" && hasValue) {
+			options.jsonPath = argv[++i];
+		}
+		else {
+			std::fprintf(stderr, "usage: %s [--sizes 256,512,1024,2000] [--repetitions 3] [--filter name] [--json results.json]\n", argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	if (!ParseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	BenchmarkRunner runner(options);
+	for (int size : options.sizes) {
+		//terrain size is in world units, the heightmap has two texels per unit like in the editor
+		std::shared_ptr<Heightmap> heightmap = std::make_shared<Heightmap>(float(size), size * 2, 1.f);
+
+		if (runner.IsEnabled("noise")) {
+			BenchmarkNoise(runner, heightmap, size);
+		}
+		if (runner.IsEnabled("rescale")) {
+			BenchmarkRescale(runner, heightmap, size);
+		}
+		heightmap->GenerateHeightsUsingNoise(1, 1.f);
+
+		if (runner.IsEnabled("terrain_build")) {
+			BenchmarkTerrainBuild(runner, heightmap, size);
+		}
+		if (runner.IsEnabled("raycast")) {
+			BenchmarkRaycast(runner, heightmap, size);
+		}
+		if (runner.IsEnabled("export")) {
+			BenchmarkExport(runner, heightmap, size);
+		}
+		//sculpting and erosion last, they change the heights the other cases run on
+		if (runner.IsEnabled("sculpt")) {
+			BenchmarkSculpt(runner, heightmap, size);
+		}
+		if (runner.IsEnabled("brush_tool")) {
+			BenchmarkBrushTools(runner, heightmap, size);
+		}
+		if (runner.IsEnabled("erosion")) {
+			BenchmarkErosion(runner, heightmap, size);
+		}
+	}
+
+	if (!options.jsonPath.empty() && !runner.WriteJson(options.jsonPath)) {
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,113 @@
+// Compares the min/max height pyramid raycast with the sphere tracing marcher it replaced.
+// Runs without a window or GL context, see CMakeLists.txt in this folder.
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "../terrain/heightmap.h"
+#include "../terrain/height_pyramid.h"
+#include "../raycasting/raycaster.hpp"
+
+struct Ray {
+	glm::vec3 origin;
+	glm::vec3 direction;
+};
+
+// cameras above the terrain looking down at it, like the brush ray from the editor camera. most of the view is close to
+// the horizon, so shallow rays are common
+static std::vector<Ray> GenerateRays(const Heightmap& heightmap, int count, unsigned int seed) {
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> position(-heightmap.GetSize(), heightmap.GetSize());
+	std::uniform_real_distribution<float> altitude(5.f, 150.f);
+	std::uniform_real_distribution<float> yaw(0.f, glm::two_pi<float>());
+	std::uniform_real_distribution<float> pitch(glm::radians(1.f), glm::radians(45.f));
+
+	std::vector<Ray> rays;
+	for (int i = 0; i < count; i++) {
+		float rayYaw = yaw(random);
+		float rayPitch = pitch(random);
+		Ray ray;
+		ray.origin = glm::vec3(position(random), heightmap.GetMaxHeight() + altitude(random), position(random));
+		ray.direction = glm::normalize(glm::vec3(std::cos(rayYaw) * std::cos(rayPitch), -std::sin(rayPitch), std::sin(rayYaw) * std::cos(rayPitch)));
+		rays.push_back(ray);
+	}
+	return rays;
+}
+
+template<typename Function>
+static double MeasureSeconds(Function function) {
+	auto start = std::chrono::steady_clock::now();
+	function();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool IsHit(const glm::vec3& point) {
+	return point.y != std::numeric_limits<float>::max();
+}
+
+int main() {
+	const int rayCount = 10000;
+	const int repetitions = 3;
+
+	std::printf("%-6s %-10s %12s %12s %10s %10s %14s\n", "size", "method", "ns/ray", "build ms", "hits", "misses", "median offset");
+
+	for (float size : { 256.f, 512.f, 1024.f, 2048.f }) {
+		Heightmap heightmap(size, int(size * 2), 1.f);
+		heightmap.GenerateHeightsUsingNoise(1, 1.f);
+		std::vector<Ray> rays = GenerateRays(heightmap, rayCount, 1234);
+
+		HeightPyramid pyramid;
+		double buildSeconds = MeasureSeconds([&]() { pyramid = HeightPyramid(heightmap); });
+
+		std::vector<glm::vec3> marchedHits(rays.size());
+		std::vector<glm::vec3> pyramidHits(rays.size());
+		double marchSeconds = DBL_MAX;
+		double pyramidSeconds = DBL_MAX;
+
+		//best of several runs to keep scheduling noise out of the numbers
+		for (int repetition = 0; repetition < repetitions; repetition++) {
+			marchSeconds = std::min(marchSeconds, MeasureSeconds([&]() {
+				for (size_t i = 0; i < rays.size(); i++) {
+					marchedHits[i] = Raycaster::MarchRay(rays[i].origin, rays[i].direction, heightmap);
+				}
+			}));
+			pyramidSeconds = std::min(pyramidSeconds, MeasureSeconds([&]() {
+				for (size_t i = 0; i < rays.size(); i++) {
+					pyramidHits[i] = Raycaster::RaycastHeightPyramid(rays[i].origin, rays[i].direction, heightmap, pyramid);
+				}
+			}));
+		}
+
+		//the pyramid has to give the same answer every time
+		for (size_t i = 0; i < rays.size(); i++) {
+			glm::vec3 repeated = Raycaster::RaycastHeightPyramid(rays[i].origin, rays[i].direction, heightmap, pyramid);
+			if (repeated != pyramidHits[i]) {
+				std::printf("pyramid raycast is not deterministic for ray %zu\n", i);
+				return 1;
+			}
+		}
+
+		//distance between the two answers where both methods hit. the marcher snaps to texels, so they rarely match exactly
+		std::vector<float> offsets;
+		int marchedHitCount = 0;
+		int pyramidHitCount = 0;
+		for (size_t i = 0; i < rays.size(); i++) {
+			marchedHitCount += IsHit(marchedHits[i]);
+			pyramidHitCount += IsHit(pyramidHits[i]);
+			if (IsHit(marchedHits[i]) && IsHit(pyramidHits[i])) {
+				offsets.push_back(glm::distance(marchedHits[i], pyramidHits[i]));
+			}
+		}
+		std::sort(offsets.begin(), offsets.end());
+		float medianOffset = offsets.empty() ? 0.f : offsets[offsets.size() / 2];
+
+		std::printf("%-6d %-10s %12.0f %12s %10d %10d %14s\n", int(size), "march", marchSeconds / rays.size() * 1e9, "-",
+			marchedHitCount, rayCount - marchedHitCount, "-");
+		std::printf("%-6d %-10s %12.0f %12.2f %10d %10d %14.3f\n", int(size), "pyramid", pyramidSeconds / rays.size() * 1e9, buildSeconds * 1e3,
+			pyramidHitCount, rayCount - pyramidHitCount, medianOffset);
+	}
+
+	return 0;
+}
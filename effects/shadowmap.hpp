@@ -1,5 +1,6 @@
 #pragma once
 #include "../engine/data_factory.h"
+#include "../engine/gl_state.h"
 
 struct Shadowmap {
 	GLuint textureID;
@@ -14,7 +15,7 @@ struct Shadowmap {
 
 		textureID = dataFactory.CreateTexture();
 		fboID = dataFactory.CreateFBO();
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::Get().BindTextureForEdit(GL_TEXTURE_2D, textureID);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -26,14 +27,18 @@ struct Shadowmap {
 		glDrawBuffer(GL_NONE);
 		glReadBuffer(GL_NONE);
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
 
-		glBindTexture(GL_TEXTURE_2D, 0);
-
+	//keeps the texture and fbo, only the depth storage is re-specified
+	void Resize(int resolution) {
+		shadowMapResolution = resolution;
+		GLState::Get().BindTextureForEdit(GL_TEXTURE_2D, textureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, shadowMapResolution, shadowMapResolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	}
 
 	void BindFrameBuffer() {
 		glBindFramebuffer(GL_FRAMEBUFFER, fboID);
-		glEnable(GL_DEPTH_TEST);
+		GLState::Get().SetEnabled(GL_DEPTH_TEST, true);
 		glViewport(0, 0, shadowMapResolution, shadowMapResolution);
 		glClear(GL_DEPTH_BUFFER_BIT);
 	}
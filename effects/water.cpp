@@ -1,4 +1,5 @@
 #include "water.h"
+#include "../engine/gl_state.h"
 
 Water::Water(Model model, DataFactory dataFactory, GLuint dudvMapTextureID, GLuint normalmap, float size, int displayWidth, int displayHeight)
 	: m_model(model), m_dudvMapTextureID(dudvMapTextureID), m_normalmapTextureID(normalmap), m_size(size), m_width(displayWidth), m_height(displayHeight) {
@@ -28,22 +29,21 @@ Water::Water(Model model, DataFactory dataFactory, GLuint dudvMapTextureID, GLui
 // 0 for reflection, 1 for refraction
 void Water::BindFramebuffer(int frameBufferType) {
 	GLuint fboID = frameBufferType == 0 ? m_reflectionFboID : m_refractionFboID;
-	glBindTexture(GL_TEXTURE_2D, 0);
 	glBindFramebuffer(GL_FRAMEBUFFER, fboID);
 	glViewport(0, 0, m_scaledWidth, m_scaledHeight);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_CLIP_DISTANCE0);
+	GLState::Get().SetEnabled(GL_CLIP_DISTANCE0, true);
 }
 
 void Water::UnbindFramebuffer() {
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glViewport(0, 0, m_width, m_height);
-	glDisable(GL_CLIP_DISTANCE0);
+	GLState::Get().SetEnabled(GL_CLIP_DISTANCE0, false);
 }
 
 GLuint Water::CreateTextureAttachment(DataFactory dataFactory, int width, int height){
 	GLuint textureID = dataFactory.CreateTexture();
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	GLState::Get().BindTextureForEdit(GL_TEXTURE_2D, textureID);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -55,7 +55,7 @@ GLuint Water::CreateTextureAttachment(DataFactory dataFactory, int width, int he
 
 GLuint Water::CreateDepthTextureAttachment(DataFactory dataFactory, int width, int height){
 	GLuint textureID = dataFactory.CreateTexture();
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	GLState::Get().BindTextureForEdit(GL_TEXTURE_2D, textureID);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
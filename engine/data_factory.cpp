@@ -1,6 +1,7 @@
+#include <algorithm>
 #include <string>
-#include <stb/stb_image.h>
 #include "data_factory.h"
+#include "gl_state.h"
 #include "../util/util.h"
 #include <filesystem>
 
@@ -20,6 +21,14 @@ GLuint DataFactory::CreateVBO(){
 	return vboID;
 }
 
+//Creates an EBO to be used for storing the indices of an indexed model
+GLuint DataFactory::CreateEBO(){
+	GLuint eboID;
+	glGenBuffers(1, &eboID);
+	m_eboList.push_back(eboID);
+	return eboID;
+}
+
 //Create frame buffer
 GLuint DataFactory::CreateFBO() {
 	GLuint framebufferID;
@@ -50,7 +59,7 @@ Model DataFactory::CreateModel(float* vertices, float* textureCoords, int vertex
 	GLuint vaoID = CreateVAO();
 
 	//bind the vao, making all subsequent operations configure this active vao.
-	glBindVertexArray(vaoID);
+	GLState::Get().BindVertexArray(vaoID);
 	/*
 	For all models created, the attribute indices are configured as such:
 		0 for vertices
@@ -61,7 +70,7 @@ Model DataFactory::CreateModel(float* vertices, float* textureCoords, int vertex
 	CreateAndPopulateBuffer(0, 3, vertices, vertexCount);
 	CreateAndPopulateBuffer(1, 2, textureCoords, vertexCount);
 
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(0);
 	return Model(vaoID, vertexCount);
 }
 
@@ -72,7 +81,7 @@ Model DataFactory::CreateModelWithoutTextureCoords(float* vertices, int vertexCo
 	GLuint vaoID = CreateVAO();
 
 	//bind the vao, making all subsequent operations configure this active vao.
-	glBindVertexArray(vaoID);
+	GLState::Get().BindVertexArray(vaoID);
 	/*
 	For all models created, the attribute indices are configured as such:
 		0 for vertices
@@ -81,10 +90,39 @@ Model DataFactory::CreateModelWithoutTextureCoords(float* vertices, int vertexCo
 	//Create 2 vbos that dictate how data is layed out for this model
 	CreateAndPopulateBuffer(0, 3, vertices, vertexCount);
 
-	glBindVertexArray(0);
+	GLState::Get().BindVertexArray(0);
 	return Model(vaoID, vertexCount);
 }
 
+// Create an indexed model from interleaved [x,y,z,u,v] vertex data and an index buffer of GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+Model DataFactory::CreateIndexedModel(float* interleavedVertices, int vertexCount, const void* indices, int indexCount, GLenum indexType)
+{
+	const int vertexWidth = 5;
+	size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+
+	GLuint vaoID = CreateVAO();
+	GLState::Get().BindVertexArray(vaoID);
+
+	//one vbo holds both attributes, 0 for vertices and 1 for texture coordinates, read with a stride of the whole vertex
+	GLuint vboID = CreateVBO();
+	glBindBuffer(GL_ARRAY_BUFFER, vboID);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * vertexWidth * sizeof(float), interleavedVertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertexWidth * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, vertexWidth * sizeof(float), (void*)(3 * sizeof(float)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//the element buffer binding is part of the vao state, so it stays bound until the vao is unbound
+	GLuint eboID = CreateEBO();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indices, GL_STATIC_DRAW);
+
+	GLState::Get().BindVertexArray(0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	return Model(vaoID, vertexCount, indexCount, indexType);
+}
+
 // Store object data in the vertex buffer object.
 void DataFactory::CreateAndPopulateBuffer(int attributeIndex, int elementWidth, float* data, int dataLength) {
 	//create vbo
@@ -105,66 +143,6 @@ void DataFactory::CreateAndPopulateBuffer(int attributeIndex, int elementWidth,
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-GLuint DataFactory::LoadTexture(std::string texturePath){
-	//stb stuff -------------------------------------------->
-	stbi_set_flip_vertically_on_load(1);
-
-	int width = 0;
-	int height = 0;
-	int bpp = 0;
-
-	//load texture from file
-	unsigned char* pImageData = stbi_load(texturePath.c_str(), &width, &height, &bpp, STBI_rgb_alpha);
-
-	if (!pImageData) {
-		util::fatal_error("Can't load texture from '%s' - %s\n", texturePath.c_str(), stbi_failure_reason());
-	}
-
-	printf("Loaded texture with Width: %d, height: %d, bpp: %d\n", width, height, bpp);
-
-	GLuint textureID = CreateTexture();
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); //set to trilinear filtering for smoothness
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pImageData);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	stbi_image_free(pImageData);
-
-	return textureID;
-}
-
-GLuint DataFactory::LoadCubemapTexture(std::vector<std::string> texturePaths)
-{
-	GLuint textureID = CreateTexture();
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-	for (int i = 0; i < texturePaths.size(); i++) {
-		int width;
-		int height;
-		int channels;
-		stbi_set_flip_vertically_on_load(0);
-		unsigned char* data = stbi_load(texturePaths[i].c_str(), &width, &height, &channels, STBI_rgb);
-		if (!data) {
-			util::fatal_error("Can't load texture from '%s' - %s\n", texturePaths[i].c_str(), stbi_failure_reason());
-		}
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		stbi_image_free(data);
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-
-	return textureID;
-}
-
-
-
 void DataFactory::DeleteDataObjects()
 {
 	for (auto vao : m_vaoList) {
@@ -173,7 +151,12 @@ void DataFactory::DeleteDataObjects()
 	for (auto vbo : m_vboList) {
 		glDeleteBuffers(1, &vbo);
 	}
+	for (auto ebo : m_eboList) {
+		glDeleteBuffers(1, &ebo);
+	}
 	for (auto texture : m_textureList) {
 		glDeleteTextures(1, &texture);
 	}
+	//deleting unbinds, and new objects may get the old names
+	GLState::Get().Invalidate();
 }
@@ -6,6 +6,8 @@
 struct Model {
 	GLuint vaoID;
 	int vertexCount;
+	int indexCount = 0; // 0 for models drawn with glDrawArrays
+	GLenum indexType = GL_UNSIGNED_INT;
 	
 	Model() = default;
 
@@ -13,6 +15,13 @@ struct Model {
 		this->vaoID = vaoID;
 		this->vertexCount = vertexCount;
 	}
+
+	Model(GLuint vaoID, int vertexCount, int indexCount, GLenum indexType) {
+		this->vaoID = vaoID;
+		this->vertexCount = vertexCount;
+		this->indexCount = indexCount;
+		this->indexType = indexType;
+	}
 };
 
 
@@ -22,18 +31,19 @@ public:
 	DataFactory();
 	GLuint CreateVAO();
 	GLuint CreateVBO();
+	GLuint CreateEBO();
 	GLuint CreateTexture();
 	GLuint CreateFBO();
 	void CreateAndPopulateBuffer(int attributeIndex, int elementWidth, float* data, int dataLength);
 	Model CreateModel(float* vertices, float* textures, int vertexCount);
 	Model CreateModelWithoutTextureCoords(float* vertices, int vertexCount);
-	GLuint LoadTexture(std::string texturePath);
-	GLuint LoadCubemapTexture(std::vector<std::string> texturePaths);
+	Model CreateIndexedModel(float* interleavedVertices, int vertexCount, const void* indices, int indexCount, GLenum indexType);
 	void DeleteDataObjects();
 
 private: 
 	std::vector<GLuint> m_vaoList;
 	std::vector<GLuint> m_vboList;
+	std::vector<GLuint> m_eboList;
 	std::vector<GLuint> m_fboList;
 	std::vector<GLuint> m_textureList;
 	std::string workingDirectory; 
@@ -2,6 +2,7 @@
 #include <imgui/imgui_impl_opengl3.h>
 #include <imgui/imgui_impl_sdl2.h>
 #include "../util/util.h"
+#include "profiler.h"
 #include "display.h"
 
 Display::Display(std::string display_name, int width, int height)
@@ -37,6 +38,7 @@ Display::Display(std::string display_name, int width, int height)
 	if (!m_context) {
 		util::fatal_error("SDL_GL_CreateContext: %s", SDL_GetError());
 	}
+	Profiler::Get().EndStartupPhase("Window");
 
 	if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
 		util::fatal_error("Failed to initialize Glad");
@@ -49,6 +51,7 @@ Display::Display(std::string display_name, int width, int height)
 
 	ImGui_ImplSDL2_InitForOpenGL(m_window, m_context);
 	ImGui_ImplOpenGL3_Init("#version 330 core");
+	Profiler::Get().EndStartupPhase("GL load");
 }
 
 SDL_Window* Display::GetWindow() const
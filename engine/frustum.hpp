@@ -0,0 +1,41 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// View frustum planes extracted from a view projection matrix. Used to skip geometry outside of the view.
+struct Frustum {
+	glm::vec4 planes[6]; // left, right, bottom, top, near, far. normals point inside
+
+	Frustum() = default;
+
+	Frustum(const glm::mat4& viewProjection) {
+		//glm matrices are column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++) {
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		}
+
+		planes[0] = rows[3] + rows[0];
+		planes[1] = rows[3] - rows[0];
+		planes[2] = rows[3] + rows[1];
+		planes[3] = rows[3] - rows[1];
+		planes[4] = rows[3] + rows[2];
+		planes[5] = rows[3] - rows[2];
+	}
+
+	// returns false only if the box is completely outside one of the planes
+	bool IntersectsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+		for (const glm::vec4& plane : planes) {
+			//test the corner furthest along the plane normal
+			glm::vec3 corner(
+				plane.x >= 0.f ? boxMax.x : boxMin.x,
+				plane.y >= 0.f ? boxMax.y : boxMin.y,
+				plane.z >= 0.f ? boxMax.z : boxMin.z
+			);
+
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.f) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
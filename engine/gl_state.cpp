@@ -0,0 +1,117 @@
+#include "gl_state.h"
+
+//the capabilities the renderer toggles, in the order of m_capabilities
+static const GLenum TRACKED_CAPABILITIES[] = { GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_CLIP_DISTANCE0, GL_TEXTURE_CUBE_MAP_SEAMLESS };
+
+GLState& GLState::Get() {
+	static GLState state;
+	return state;
+}
+
+GLState::GLState() {
+	Invalidate();
+}
+
+int GLState::GetTargetIndex(GLenum target) {
+	return target == GL_TEXTURE_CUBE_MAP ? 1 : 0;
+}
+
+int GLState::GetCapabilityIndex(GLenum capability) {
+	for (int i = 0; i < CAPABILITY_COUNT; i++) {
+		if (TRACKED_CAPABILITIES[i] == capability) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool GLState::Change(GLuint& current, GLuint value) {
+	if (current == value) {
+		m_stats.skipped++;
+		return false;
+	}
+	current = value;
+	m_stats.calls++;
+	return true;
+}
+
+void GLState::UseProgram(GLuint program) {
+	if (Change(m_program, program)) {
+		glUseProgram(program);
+	}
+}
+
+void GLState::BindVertexArray(GLuint vertexArray) {
+	if (Change(m_vertexArray, vertexArray)) {
+		glBindVertexArray(vertexArray);
+	}
+}
+
+//the active unit is only switched when the binding changes, so a bound texture costs nothing at all
+void GLState::BindTexture(int unit, GLenum target, GLuint texture) {
+	GLuint& bound = m_textures[unit][GetTargetIndex(target)];
+	if (bound == texture) {
+		m_stats.skipped++;
+		return;
+	}
+	if (Change(m_activeUnit, GLuint(unit))) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+	bound = texture;
+	m_stats.calls++;
+	glBindTexture(target, texture);
+}
+
+void GLState::BindTextureForEdit(GLenum target, GLuint texture) {
+	if (Change(m_activeUnit, GLuint(EDIT_TEXTURE_UNIT))) {
+		glActiveTexture(GL_TEXTURE0 + EDIT_TEXTURE_UNIT);
+	}
+	BindTexture(EDIT_TEXTURE_UNIT, target, texture);
+}
+
+void GLState::SetEnabled(GLenum capability, bool enabled) {
+	int index = GetCapabilityIndex(capability);
+	if (index >= 0 && !Change(m_capabilities[index], GLuint(enabled))) {
+		return;
+	}
+	if (enabled) {
+		glEnable(capability);
+	}
+	else {
+		glDisable(capability);
+	}
+}
+
+void GLState::SetDepthMask(bool enabled) {
+	if (Change(m_depthMask, GLuint(enabled))) {
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLState::SetCullFace(GLenum face) {
+	if (Change(m_cullFace, face)) {
+		glCullFace(face);
+	}
+}
+
+void GLState::Invalidate() {
+	m_program = UNKNOWN;
+	m_vertexArray = UNKNOWN;
+	m_activeUnit = UNKNOWN;
+	for (int unit = 0; unit < TEXTURE_UNITS; unit++) {
+		for (int target = 0; target < TEXTURE_TARGETS; target++) {
+			m_textures[unit][target] = UNKNOWN;
+		}
+	}
+	for (GLuint& capability : m_capabilities) {
+		capability = UNKNOWN;
+	}
+	m_depthMask = UNKNOWN;
+	m_cullFace = UNKNOWN;
+}
+
+GLStateStats GLState::TakeStats() {
+	GLStateStats stats = m_stats;
+	m_stats = GLStateStats();
+	return stats;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <glad/glad.h>
+
+// GL calls made through the state since the stats were last taken, and the ones filtered out as redundant
+struct GLStateStats {
+	int calls = 0;
+	int skipped = 0;
+};
+
+// Shadow copy of the GL state the renderer changes: the program, the vertex array, the textures of every unit and the
+// capabilities it toggles. Binding what is already bound or enabling what is already enabled costs no GL call, so a
+// pass can set all the state it needs instead of restoring what the previous pass changed.
+//
+// Everything that changes this state has to go through here, anything else has to call Invalidate afterwards. ImGui's
+// OpenGL backend restores what it changes, so it can draw in between
+class GLState {
+public:
+	static const int TEXTURE_UNITS = 16;
+	// unit textures are bound on to be created or updated. no program samples from it, so editing a texture never
+	// disturbs the textures bound for drawing
+	static const int EDIT_TEXTURE_UNIT = TEXTURE_UNITS - 1;
+
+	static GLState& Get();
+
+	//prevent copying
+	GLState(const GLState&) = delete;
+	GLState& operator=(const GLState&) = delete;
+
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vertexArray);
+	// target is GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+	void BindTexture(int unit, GLenum target, GLuint texture);
+	// binds on the edit unit and makes it the active one, for glTexImage2D, glTexParameter and the like
+	void BindTextureForEdit(GLenum target, GLuint texture);
+	// capabilities other than the tracked ones go straight to GL
+	void SetEnabled(GLenum capability, bool enabled);
+	void SetDepthMask(bool enabled);
+	void SetCullFace(GLenum face);
+
+	// forgets everything, the next change of each state is sent whatever it is
+	void Invalidate();
+	// the counts since the last call
+	GLStateStats TakeStats();
+
+private:
+	GLState();
+
+	static const GLuint UNKNOWN = GLuint(-1);
+	static const int TEXTURE_TARGETS = 2;
+	static const int CAPABILITY_COUNT = 5;
+
+	static int GetTargetIndex(GLenum target);
+	static int GetCapabilityIndex(GLenum capability);
+	// true if the value differs from the shadow copy, which then takes the value
+	bool Change(GLuint& current, GLuint value);
+
+	GLuint m_program;
+	GLuint m_vertexArray;
+	GLuint m_activeUnit;
+	GLuint m_textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+	GLuint m_capabilities[CAPABILITY_COUNT]; // 0 or 1
+	GLuint m_depthMask;
+	GLuint m_cullFace;
+	GLStateStats m_stats;
+};
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include "profiler.h"
+
+Profiler& Profiler::Get() {
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler() : m_epoch(std::chrono::steady_clock::now()), m_cpuHistory(HISTORY_FRAMES, 0.f), m_gpuHistory(HISTORY_FRAMES, 0.f),
+	m_startupStart(m_epoch), m_startupPhaseStart(m_epoch) {
+}
+
+double Profiler::GetMilliseconds(std::chrono::steady_clock::time_point time) const {
+	return std::chrono::duration<double, std::milli>(time - m_frameStart).count();
+}
+
+//the slot of the new frame was last used QUERY_FRAMES frames ago, its queries are resolved before they are reused
+void Profiler::BeginFrame() {
+	int slot = m_frameIndex % QUERY_FRAMES;
+	if (m_pendingFrames[slot].inFlight) {
+		ResolveFrame(slot);
+	}
+
+	m_frameStart = std::chrono::steady_clock::now();
+	PendingFrame& pending = m_pendingFrames[slot];
+	pending.frame.start = std::chrono::duration<double, std::milli>(m_frameStart - m_epoch).count();
+	pending.frame.cpuTime = 0.0;
+	pending.frame.gpuTime = 0.0;
+	pending.frame.scopes.clear();
+	pending.frame.counters.clear();
+	pending.queryScopes.clear();
+	pending.inFlight = true;
+	m_inFrame = true;
+}
+
+void Profiler::EndFrame() {
+	if (!m_inFrame) {
+		return;
+	}
+	m_pendingFrames[m_frameIndex % QUERY_FRAMES].frame.cpuTime = GetMilliseconds(std::chrono::steady_clock::now());
+	m_inFrame = false;
+	m_frameIndex++;
+}
+
+void Profiler::BeginScope(const char* name, bool gpu) {
+	if (!m_inFrame) {
+		m_openScopes.push_back({ -1, false, std::chrono::steady_clock::now() });
+		return;
+	}
+
+	int slot = m_frameIndex % QUERY_FRAMES;
+	PendingFrame& pending = m_pendingFrames[slot];
+	OpenScope scope = { int(pending.frame.scopes.size()), gpu && !m_gpuScopeOpen, std::chrono::steady_clock::now() };
+	pending.frame.scopes.push_back({ name, int(m_openScopes.size()), GetMilliseconds(scope.start), 0.0, -1.0 });
+
+	if (scope.gpu) {
+		std::vector<GLuint>& queries = m_queries[slot];
+		if (queries.size() == pending.queryScopes.size()) {
+			GLuint query;
+			glGenQueries(1, &query);
+			queries.push_back(query);
+		}
+		glBeginQuery(GL_TIME_ELAPSED, queries[pending.queryScopes.size()]);
+		pending.queryScopes.push_back(scope.index);
+		m_gpuScopeOpen = true;
+	}
+	m_openScopes.push_back(scope);
+}
+
+void Profiler::EndScope() {
+	if (m_openScopes.empty()) {
+		return;
+	}
+	OpenScope scope = m_openScopes.back();
+	m_openScopes.pop_back();
+	if (scope.index < 0 || !m_inFrame) {
+		return;
+	}
+
+	if (scope.gpu) {
+		glEndQuery(GL_TIME_ELAPSED);
+		m_gpuScopeOpen = false;
+	}
+	ProfilerScopeTiming& timing = m_pendingFrames[m_frameIndex % QUERY_FRAMES].frame.scopes[scope.index];
+	timing.cpuTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scope.start).count();
+}
+
+void Profiler::SetCounter(const char* name, double value) {
+	if (!m_inFrame) {
+		return;
+	}
+	std::vector<ProfilerCounter>& counters = m_pendingFrames[m_frameIndex % QUERY_FRAMES].frame.counters;
+	for (ProfilerCounter& counter : counters) {
+		if (std::strcmp(counter.name, name) == 0) {
+			counter.value = value;
+			return;
+		}
+	}
+	counters.push_back({ name, value });
+}
+
+void Profiler::BeginStartup() {
+	m_startupStart = std::chrono::steady_clock::now();
+	m_startupPhaseStart = m_startupStart;
+	m_startupPhases.clear();
+}
+
+//GL calls return before the driver is done with them. the phases that follow absorb the rest of the work, a phase that
+//ends with the first frame on screen makes sure the total covers all of it
+void Profiler::EndStartupPhase(const char* name) {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	m_startupPhases.push_back({ name, std::chrono::duration<double, std::milli>(now - m_startupPhaseStart).count() });
+	m_startupPhaseStart = now;
+}
+
+double Profiler::GetStartupTime() const {
+	double time = 0.0;
+	for (const ProfilerStartupPhase& phase : m_startupPhases) {
+		time += phase.time;
+	}
+	return time;
+}
+
+double Profiler::GetTimeSinceStartup() const {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startupStart).count();
+}
+
+//reads the GPU times of a finished frame and publishes it. queries finish in order, so if the last one is available all
+//of them are. if the GPU is still behind the frame keeps its CPU times only, waiting on it would stall the pipeline
+void Profiler::ResolveFrame(int slot) {
+	PendingFrame& pending = m_pendingFrames[slot];
+	pending.inFlight = false;
+
+	if (!pending.queryScopes.empty()) {
+		const std::vector<GLuint>& queries = m_queries[slot];
+		GLuint available = 0;
+		glGetQueryObjectuiv(queries[pending.queryScopes.size() - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			for (size_t i = 0; i < pending.queryScopes.size(); i++) {
+				GLuint64 elapsedNanoseconds = 0;
+				glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsedNanoseconds);
+				double gpuTime = elapsedNanoseconds / 1e6;
+				pending.frame.scopes[pending.queryScopes[i]].gpuTime = gpuTime;
+				pending.frame.gpuTime += gpuTime; //gpu scopes never nest, so they can be summed
+			}
+		}
+	}
+
+	m_lastFrame = pending.frame;
+
+	m_cpuHistory.erase(m_cpuHistory.begin());
+	m_cpuHistory.push_back(float(m_lastFrame.cpuTime));
+	m_gpuHistory.erase(m_gpuHistory.begin());
+	m_gpuHistory.push_back(float(m_lastFrame.gpuTime));
+
+	m_traceFrames.push_back(m_lastFrame);
+	if (m_traceFrames.size() > TRACE_FRAMES) {
+		m_traceFrames.pop_front();
+	}
+}
+
+//every scope becomes a complete event on the CPU track. GL_TIME_ELAPSED only measures durations, so GPU events are laid
+//out on their own track starting no earlier than their CPU scope and no earlier than the previous GPU event ended.
+//counters become counter events at the start of their frame
+bool Profiler::WriteChromeTrace(const std::string& filePath) const {
+	std::ofstream file(filePath);
+	if (!file.is_open()) {
+		std::cerr << "Error trying to open file for writing: " << filePath << std::endl;
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	//trace timestamps are in microseconds
+	auto WriteEvent = [&](const char* name, int thread, double start, double duration) {
+		file << ",\n{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+			<< ",\"ts\":" << start * 1000.0 << ",\"dur\":" << duration * 1000.0 << "}";
+	};
+
+	double gpuCursor = 0.0;
+	for (const ProfilerFrame& frame : m_traceFrames) {
+		WriteEvent("Frame", 1, frame.start, frame.cpuTime);
+		for (const ProfilerScopeTiming& scope : frame.scopes) {
+			WriteEvent(scope.name, 1, frame.start + scope.cpuStart, scope.cpuTime);
+			if (scope.gpuTime >= 0.0) {
+				double gpuStart = std::max(frame.start + scope.cpuStart, gpuCursor);
+				WriteEvent(scope.name, 2, gpuStart, scope.gpuTime);
+				gpuCursor = gpuStart + scope.gpuTime;
+			}
+		}
+		for (const ProfilerCounter& counter : frame.counters) {
+			file << ",\n{\"name\":\"" << counter.name << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << frame.start * 1000.0
+				<< ",\"args\":{\"value\":" << counter.value << "}}";
+		}
+	}
+	file << "\n]}\n";
+
+	file.close();
+	if (file.fail()) {
+		std::cerr << "Error writing to file: " << filePath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void Profiler::Destroy() {
+	for (std::vector<GLuint>& queries : m_queries) {
+		if (!queries.empty()) {
+			glDeleteQueries(GLsizei(queries.size()), queries.data());
+		}
+		queries.clear();
+	}
+	for (PendingFrame& pending : m_pendingFrames) {
+		pending.inFlight = false;
+	}
+}
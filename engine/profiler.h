@@ -0,0 +1,126 @@
+#pragma once
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// Timing of one scope in a finished frame. times are in milliseconds, gpuTime is negative for scopes without a query
+struct ProfilerScopeTiming {
+	const char* name;
+	int depth;
+	double cpuStart; // from the start of the frame
+	double cpuTime;
+	double gpuTime;
+};
+
+// A value that is counted per frame rather than timed, like bytes uploaded
+struct ProfilerCounter {
+	const char* name;
+	double value;
+};
+
+// A step of the startup, in milliseconds
+struct ProfilerStartupPhase {
+	const char* name;
+	double time;
+};
+
+struct ProfilerFrame {
+	double start = 0.0; // from the start of the profiler, in milliseconds
+	double cpuTime = 0.0;
+	double gpuTime = 0.0; // sum of the top level gpu scopes
+	std::vector<ProfilerScopeTiming> scopes;
+	std::vector<ProfilerCounter> counters;
+};
+
+// Frame profiler for the main thread. Scopes measure CPU time, and GPU scopes also wrap their GL commands in a
+// GL_TIME_ELAPSED query. Query results are read QUERY_FRAMES frames later, once the GPU is done with them, so reading
+// never stalls the pipeline and a frame only shows up in the breakdown when its GPU times are known.
+class Profiler {
+public:
+	static const int QUERY_FRAMES = 3;
+	static const int HISTORY_FRAMES = 240;  // frames in the rolling graph
+	static const int TRACE_FRAMES = 1200;   // frames kept for the chrome trace
+
+	static Profiler& Get();
+
+	//prevent copying
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	void BeginFrame();
+	void EndFrame();
+	void BeginScope(const char* name, bool gpu);
+	void EndScope();
+	// sets a counter of the current frame, counters are told apart by their name
+	void SetCounter(const char* name, double value);
+
+	// latest frame whose GPU times are known
+	const ProfilerFrame& GetLastFrame() const { return m_lastFrame; }
+	// frame times in milliseconds, oldest first, HISTORY_FRAMES long
+	const std::vector<float>& GetCpuHistory() const { return m_cpuHistory; }
+	const std::vector<float>& GetGpuHistory() const { return m_gpuHistory; }
+
+	// startup phases are timed back to back, each one ends where the next starts. the first starts at BeginStartup
+	void BeginStartup();
+	void EndStartupPhase(const char* name);
+	const std::vector<ProfilerStartupPhase>& GetStartupPhases() const { return m_startupPhases; }
+	double GetStartupTime() const;
+	// milliseconds since BeginStartup, for work that finishes in the background after the first frame
+	double GetTimeSinceStartup() const;
+
+	// writes the kept frames in the chrome trace event format (chrome://tracing, perfetto). returns false if the file
+	// couldn't be written
+	bool WriteChromeTrace(const std::string& filePath) const;
+
+	void Destroy();
+
+private:
+	Profiler();
+
+	struct OpenScope {
+		int index; // -1 for scopes outside of a frame
+		bool gpu;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	struct PendingFrame {
+		ProfilerFrame frame;
+		std::vector<int> queryScopes; // scope of each query, in the order the queries were issued
+		bool inFlight = false;
+	};
+
+	void ResolveFrame(int slot);
+	double GetMilliseconds(std::chrono::steady_clock::time_point time) const;
+
+	std::chrono::steady_clock::time_point m_epoch;
+	std::chrono::steady_clock::time_point m_frameStart;
+	PendingFrame m_pendingFrames[QUERY_FRAMES];
+	std::vector<GLuint> m_queries[QUERY_FRAMES]; // grows to the most gpu scopes a frame has used
+	int m_frameIndex = 0;
+	bool m_inFrame = false;
+	bool m_gpuScopeOpen = false;
+	std::vector<OpenScope> m_openScopes;
+
+	ProfilerFrame m_lastFrame;
+	std::vector<float> m_cpuHistory;
+	std::vector<float> m_gpuHistory;
+	std::deque<ProfilerFrame> m_traceFrames;
+
+	std::chrono::steady_clock::time_point m_startupStart;
+	std::chrono::steady_clock::time_point m_startupPhaseStart;
+	std::vector<ProfilerStartupPhase> m_startupPhases;
+};
+
+// Profiles the enclosing block. GL_TIME_ELAPSED queries can't nest, so a gpu scope inside another gpu scope only
+// measures CPU time.
+class ProfileScope {
+public:
+	explicit ProfileScope(const char* name, bool gpu = false) { Profiler::Get().BeginScope(name, gpu); }
+	~ProfileScope() { Profiler::Get().EndScope(); }
+
+	//prevent copying
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
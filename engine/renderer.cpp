@@ -3,6 +3,7 @@
 #include <imgui/imgui_impl_opengl3.h>
 #include <imgui/imgui_impl_sdl2.h>
 #include "renderer.h"
+#include "gl_state.h"
 
 
 
@@ -27,9 +28,10 @@ void Renderer::PrepareImGuiFrame() {
 }
 
 void Renderer::PrepareFrame(){
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_FRONT);
+	GLState& state = GLState::Get();
+	state.SetEnabled(GL_DEPTH_TEST, true);
+	state.SetEnabled(GL_CULL_FACE, true);
+	state.SetCullFace(GL_FRONT);
 	//clear color and depth buffer before rendering new frame
 	glViewport(0, 0, m_width, m_height);
 	glClearColor(0.f, 0.f, 0.f, 1.f);
@@ -42,67 +44,103 @@ void Renderer::RenderImGuiFrame() {
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
-void Renderer::RenderTerrain(const Terrain& terrain, TerrainShaderHandler terrainShaderHandler, Shadowmap shadowmap)
-{
-	glBindVertexArray(terrain.GetModel().vaoID);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	terrainShaderHandler.LoadUniformSampler2D(terrainShaderHandler.uHeightmap, GL_TEXTURE0, terrain.GetHeightmap()->GetTextureID());
-	terrainShaderHandler.LoadUniformSampler2D(terrainShaderHandler.uBaseTexture, GL_TEXTURE1, terrain.GetTextureIDs()[0]);
-	terrainShaderHandler.LoadUniformSampler2D(terrainShaderHandler.uGroundTexture, GL_TEXTURE2, terrain.GetTextureIDs()[1]);
-	terrainShaderHandler.LoadUniformSampler2D(terrainShaderHandler.uRockTexture, GL_TEXTURE3, terrain.GetTextureIDs()[2]);
-	terrainShaderHandler.LoadUniformSampler2D(terrainShaderHandler.uPeaksTexture, GL_TEXTURE4, terrain.GetTextureIDs()[3]);
-	terrainShaderHandler.LoadUniformSampler2D(terrainShaderHandler.uShadowmap, GL_TEXTURE5, shadowmap.textureID);
-
-	glDrawArrays(GL_TRIANGLES, 0, terrain.GetModel().vertexCount);
-
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(0);
-	glBindVertexArray(0);
+// Distance at which a terrain quad of unit size covers m_lodPixelsPerQuad pixels on screen
+float Renderer::GetLodDistance() const {
+	float pixelsPerUnitAtUnitDistance = m_height / (2.f * tan(glm::radians(m_fov) / 2.f));
+	return pixelsPerUnitAtUnitDistance / m_lodPixelsPerQuad;
 }
 
-void Renderer::RenderSkybox(Cubemap cubemap, SkyboxShaderHandler skyboxShaderHandler) {
-	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
-	glDisable(GL_CULL_FACE);
-	glDisable(GL_DEPTH_TEST);
-	glDepthMask(GL_FALSE); 
+// Draw every patch of the selection with the shared patch mesh. The shader places and morphs each one.
+template<typename TerrainShader>
+void Renderer::DrawTerrainPatches(const Terrain& terrain, TerrainShader& shader, const TerrainSelection& selection) {
+	Model model = terrain.GetModel();
+	size_t indexSize = model.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	int quadrantIndexCount = model.indexCount / 4;
+
+	shader.SetTerrainDimensions(terrain.GetHeightmap()->GetResolution() - 1.f, terrain.GetHeightmap()->GetSize());
+
+	for (const TerrainPatch& patch : selection.patches) {
+		shader.SetNodePlacement(glm::vec2(patch.originX, patch.originZ), float(1 << patch.level), selection.morphRanges[patch.level]);
+
+		if (patch.quadrant < 0) {
+			glDrawElements(GL_TRIANGLES, model.indexCount, model.indexType, 0);
+		}
+		else {
+			//the patch indices are stored one quadrant after the other
+			glDrawElements(GL_TRIANGLES, quadrantIndexCount, model.indexType, (void*)(patch.quadrant * quadrantIndexCount * indexSize));
+		}
+		m_terrainStats.drawCalls++;
+	}
+
+	m_terrainStats.patchesDrawn += int(selection.patches.size());
+	m_terrainStats.nodesCulled += selection.nodesCulled;
+}
 
-	glBindVertexArray(cubemap.GetModel().vaoID);
-	glEnableVertexAttribArray(0);
-	skyboxShaderHandler.LoadUniformSamplerCube(skyboxShaderHandler.uCubemap, GL_TEXTURE0, cubemap.GetTextureID());
-	glDrawArrays(GL_TRIANGLES, 0, cubemap.GetModel().vertexCount);
-	glDisableVertexAttribArray(0);
-	glBindVertexArray(0);
+// Render the terrain patches picked by the level of detail selection
+void Renderer::RenderTerrain(const Terrain& terrain, TerrainShaderHandler& terrainShaderHandler, Shadowmap shadowmap, const TerrainSelection& selection)
+{
+	//the attributes were enabled in the vao when the model was created
+	GLState& state = GLState::Get();
+	state.BindVertexArray(terrain.GetModel().vaoID);
+	state.BindTexture(TerrainShaderHandler::HEIGHTMAP_UNIT, GL_TEXTURE_2D, terrain.GetHeightmapTexture().GetTextureID());
+	state.BindTexture(TerrainShaderHandler::BASE_TEXTURE_UNIT, GL_TEXTURE_2D, terrain.GetTextureIDs()[0]);
+	state.BindTexture(TerrainShaderHandler::GROUND_TEXTURE_UNIT, GL_TEXTURE_2D, terrain.GetTextureIDs()[1]);
+	state.BindTexture(TerrainShaderHandler::ROCK_TEXTURE_UNIT, GL_TEXTURE_2D, terrain.GetTextureIDs()[2]);
+	state.BindTexture(TerrainShaderHandler::PEAKS_TEXTURE_UNIT, GL_TEXTURE_2D, terrain.GetTextureIDs()[3]);
+	state.BindTexture(TerrainShaderHandler::SHADOWMAP_UNIT, GL_TEXTURE_2D, shadowmap.textureID);
+
+	//morphing is driven by the camera of the Frame block, the one the selection is made for
+	DrawTerrainPatches(terrain, terrainShaderHandler, selection);
+}
 
-	glEnable(GL_CULL_FACE);
-	glDepthMask(GL_TRUE); 
-	glEnable(GL_DEPTH_TEST);
+// Render the terrain patches into the currently bound depth target
+void Renderer::RenderTerrainDepth(const Terrain& terrain, ShadowmapShaderHandler& shadowmapShaderHandler, const TerrainSelection& selection)
+{
+	GLState& state = GLState::Get();
+	state.BindVertexArray(terrain.GetModel().vaoID);
+	state.BindTexture(ShadowmapShaderHandler::HEIGHTMAP_UNIT, GL_TEXTURE_2D, terrain.GetHeightmapTexture().GetTextureID());
+	shadowmapShaderHandler.SetCameraPosition(selection.cameraPosition);
+	DrawTerrainPatches(terrain, shadowmapShaderHandler, selection);
 }
 
-void Renderer::RenderWater(Water water, WaterShaderHandler shader){
-	glBindVertexArray(water.GetModel().vaoID);
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
+//the depth state is restored afterwards, clearing a framebuffer needs the depth mask
+void Renderer::RenderSkybox(Cubemap cubemap, SkyboxShaderHandler& skyboxShaderHandler) {
+	GLState& state = GLState::Get();
+	state.SetEnabled(GL_TEXTURE_CUBE_MAP_SEAMLESS, true);
+	state.SetEnabled(GL_CULL_FACE, false);
+	state.SetEnabled(GL_DEPTH_TEST, false);
+	state.SetDepthMask(false);
 
-	shader.LoadUniformSampler2D(shader.uReflectionTexture, GL_TEXTURE0, water.GetReflectionTextureID());
-	shader.LoadUniformSampler2D(shader.uRefractionTexture, GL_TEXTURE1, water.GetRefractionTextureID());
-	shader.LoadUniformSampler2D(shader.uDudvmap, GL_TEXTURE2, water.GetDudvTextureID());
-	shader.LoadUniformSampler2D(shader.uNormalmap, GL_TEXTURE3, water.GetNormalmapTextureID());
-	shader.LoadUniformSampler2D(shader.uDepthmap, GL_TEXTURE4, water.GetDepthmapTextureID());
+	state.BindVertexArray(cubemap.GetModel().vaoID);
+	state.BindTexture(SkyboxShaderHandler::CUBEMAP_UNIT, GL_TEXTURE_CUBE_MAP, cubemap.GetTextureID());
+	glDrawArrays(GL_TRIANGLES, 0, cubemap.GetModel().vertexCount);
+
+	state.SetEnabled(GL_CULL_FACE, true);
+	state.SetDepthMask(true);
+	state.SetEnabled(GL_DEPTH_TEST, true);
+}
 
+void Renderer::RenderWater(Water water, WaterShaderHandler& shader){
+	GLState& state = GLState::Get();
+	state.BindVertexArray(water.GetModel().vaoID);
+	state.BindTexture(WaterShaderHandler::REFLECTION_UNIT, GL_TEXTURE_2D, water.GetReflectionTextureID());
+	state.BindTexture(WaterShaderHandler::REFRACTION_UNIT, GL_TEXTURE_2D, water.GetRefractionTextureID());
+	state.BindTexture(WaterShaderHandler::DUDVMAP_UNIT, GL_TEXTURE_2D, water.GetDudvTextureID());
+	state.BindTexture(WaterShaderHandler::NORMALMAP_UNIT, GL_TEXTURE_2D, water.GetNormalmapTextureID());
+	state.BindTexture(WaterShaderHandler::DEPTHMAP_UNIT, GL_TEXTURE_2D, water.GetDepthmapTextureID());
 
-	glEnable(GL_BLEND);
+	state.SetEnabled(GL_BLEND, true);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glDrawArrays(GL_TRIANGLES, 0, water.GetModel().vertexCount);
-	glDisable(GL_BLEND);
-
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(0);
-	glBindVertexArray(0);
+	state.SetEnabled(GL_BLEND, false);
 }
 
 void Renderer::Update() {
 	m_display.Update();
+
+	//start counting the next frame
+	m_lastTerrainStats = m_terrainStats;
+	m_terrainStats = TerrainRenderStats();
 }
 
 void Renderer::Destroy() {
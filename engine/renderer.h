@@ -1,13 +1,22 @@
 #pragma once
 #include <string>
 #include "display.h"
+#include "frustum.hpp"
 #include "../terrain/terrain.h"
 #include "../effects/cubemap.h"
 #include "../effects/water.h"
 #include "../shader_handlers/terrain_shader_handler.h"
+#include "../shader_handlers/shadowmap_shader_handler.h"
 #include "../shader_handlers/skybox_shader_handler.h"
 #include "../shader_handlers/water_shader_handler.h"
 
+// Terrain patch counts for the current frame, summed over every terrain pass
+struct TerrainRenderStats {
+	int patchesDrawn = 0;
+	int nodesCulled = 0;
+	int drawCalls = 0;
+};
+
 class Renderer {
 
 private:
@@ -15,22 +24,31 @@ private:
 	const float m_fov = 60.0f;
 	const float m_nearPlane = 10.f;
 	const float m_farPlane = 5000.0f;
+	const float m_lodPixelsPerQuad = 4.f; // on screen size a terrain quad is allowed to grow to before switching to a finer level
 	int m_width;
 	int m_height;
 	glm::mat4 m_projection;
+	TerrainRenderStats m_terrainStats;
+	TerrainRenderStats m_lastTerrainStats;
 
+	template<typename TerrainShader>
+	void DrawTerrainPatches(const Terrain& terrain, TerrainShader& shader, const TerrainSelection& selection);
 
 public:
 	Renderer() = default;
 	Renderer(std::string title, int width, int height);
 
 	const glm::mat4 GetProjectionMatrix() { return m_projection; }
+	const TerrainRenderStats& GetTerrainStats() const { return m_lastTerrainStats; }
 	void PrepareFrame();
 	void PrepareImGuiFrame();
 	void RenderImGuiFrame();
-	void RenderTerrain(const Terrain& terrain, TerrainShaderHandler terrainShaderHandler, Shadowmap shadowmap);
-	void RenderSkybox(Cubemap cubemap, SkyboxShaderHandler shader);
-	void RenderWater(Water water, WaterShaderHandler shader);
+	float GetLodDistance() const;
+	// the shader handlers are passed by reference, they keep the uniform values their program holds
+	void RenderTerrain(const Terrain& terrain, TerrainShaderHandler& terrainShaderHandler, Shadowmap shadowmap, const TerrainSelection& selection);
+	void RenderTerrainDepth(const Terrain& terrain, ShadowmapShaderHandler& shadowmapShaderHandler, const TerrainSelection& selection);
+	void RenderSkybox(Cubemap cubemap, SkyboxShaderHandler& shader);
+	void RenderWater(Water water, WaterShaderHandler& shader);
 	void Update();
 	void Destroy();
 };
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stb/stb_image.h>
+#include "texture_loader.h"
+#include "gl_state.h"
+#include "upload_ring.h"
+#include "../util/thread_pool.h"
+#include "../util/util.h"
+
+static const unsigned char PLACEHOLDER_TEXEL[4] = { 128, 128, 128, 255 };
+
+//stb's flip setting is shared by every thread, so it is left off and the rows are flipped here instead
+TextureImage TextureLoader::DecodeImage(const std::string& texturePath, int channels, bool flipVertically) {
+	TextureImage image;
+	int fileChannels = 0;
+	unsigned char* data = stbi_load(texturePath.c_str(), &image.width, &image.height, &fileChannels, channels);
+	if (!data) {
+		const char* reason = stbi_failure_reason();
+		image.error = reason ? reason : "unknown error";
+		return image;
+	}
+	image.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+	image.channels = channels;
+
+	if (flipVertically) {
+		size_t rowBytes = size_t(image.width) * channels;
+		std::vector<unsigned char> row(rowBytes);
+		for (int top = 0, bottom = image.height - 1; top < bottom; top++, bottom--) {
+			std::memcpy(row.data(), data + top * rowBytes, rowBytes);
+			std::memcpy(data + top * rowBytes, data + bottom * rowBytes, rowBytes);
+			std::memcpy(data + bottom * rowBytes, row.data(), rowBytes);
+		}
+	}
+	return image;
+}
+
+GLuint TextureLoader::LoadTexture(DataFactory& dataFactory, const std::string& texturePath) {
+	GLuint textureID = dataFactory.CreateTexture();
+	GLState::Get().BindTextureForEdit(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); //set to trilinear filtering for smoothness
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	//a single texel is a complete mipmap chain on its own
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER_TEXEL);
+
+	PendingTexture pending;
+	pending.textureID = textureID;
+	pending.target = GL_TEXTURE_2D;
+	pending.paths = { texturePath };
+	pending.images.push_back(util::ThreadPool::Get().Submit([texturePath]() { return DecodeImage(texturePath, STBI_rgb_alpha, true); }));
+	m_pending.push_back(std::move(pending));
+	return textureID;
+}
+
+GLuint TextureLoader::LoadCubemapTexture(DataFactory& dataFactory, const std::vector<std::string>& texturePaths) {
+	GLuint textureID = dataFactory.CreateTexture();
+	GLState::Get().BindTextureForEdit(GL_TEXTURE_CUBE_MAP, textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t i = 0; i < texturePaths.size(); i++) {
+		glTexImage2D(GLenum(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i), 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, PLACEHOLDER_TEXEL);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	PendingTexture pending;
+	pending.textureID = textureID;
+	pending.target = GL_TEXTURE_CUBE_MAP;
+	pending.paths = texturePaths;
+	for (const std::string& texturePath : texturePaths) {
+		pending.images.push_back(util::ThreadPool::Get().Submit([texturePath]() { return DecodeImage(texturePath, STBI_rgb, false); }));
+	}
+	m_pending.push_back(std::move(pending));
+	return textureID;
+}
+
+bool TextureLoader::IsReady(const PendingTexture& pending) {
+	for (const std::future<TextureImage>& image : pending.images) {
+		if (image.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//the storage is reallocated at the size of the image, a cubemap only becomes complete again once every face has it
+size_t TextureLoader::Upload(PendingTexture& pending) {
+	GLState::Get().BindTextureForEdit(pending.target, pending.textureID);
+	size_t bytes = 0;
+	for (size_t i = 0; i < pending.images.size(); i++) {
+		TextureImage image = pending.images[i].get();
+		if (!image.pixels) {
+			util::fatal_error("Can't load texture from '%s' - %s\n", pending.paths[i].c_str(), image.error.c_str());
+		}
+
+		GLenum target = pending.target == GL_TEXTURE_CUBE_MAP ? GLenum(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i) : GL_TEXTURE_2D;
+		GLenum format = image.channels == STBI_rgb_alpha ? GL_RGBA : GL_RGB;
+		glTexImage2D(target, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+		UploadRing::Get().UploadTexture2D(target, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, image.channels, image.pixels.get(), image.width);
+		bytes += size_t(image.width) * image.height * image.channels;
+		printf("Loaded texture with Width: %d, height: %d, bpp: %d\n", image.width, image.height, image.channels);
+	}
+	if (pending.target == GL_TEXTURE_2D) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	return bytes;
+}
+
+//the textures whose images are ready are uploaded in the order they were requested, until the budget is spent
+void TextureLoader::Update() {
+	size_t uploaded = 0;
+	for (size_t i = 0; i < m_pending.size() && uploaded < UPLOAD_BUDGET;) {
+		if (IsReady(m_pending[i])) {
+			uploaded += Upload(m_pending[i]);
+			m_pending.erase(m_pending.begin() + i);
+		}
+		else {
+			i++;
+		}
+	}
+}
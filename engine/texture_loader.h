@@ -0,0 +1,62 @@
+#pragma once
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "data_factory.h"
+
+// Pixels of a decoded image file, freed with stb_image
+struct TextureImage {
+	std::shared_ptr<unsigned char> pixels; // rows from the top, nullptr if the file couldn't be decoded
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	std::string error;
+};
+
+// Loads texture files without blocking the render thread. The files are decoded on the thread pool, all at once, and
+// every texture exists right away with a single mid grey texel that is drawn until its image is ready. Mid grey also
+// reads as flat in the water's normal and distortion maps. Update uploads the finished images through the upload ring
+// and builds their mipmaps, on the render thread since that is where the GL context is.
+//
+// A file that can't be decoded is a fatal error, like it was when textures were loaded in place
+class TextureLoader {
+public:
+	// the most bytes Update uploads in a frame, it always uploads at least one texture
+	static const size_t UPLOAD_BUDGET = 16 * 1024 * 1024;
+
+	TextureLoader() = default;
+
+	//prevent copying
+	TextureLoader(const TextureLoader&) = delete;
+	TextureLoader& operator=(const TextureLoader&) = delete;
+
+	// rgba texture with mipmaps, repeated
+	GLuint LoadTexture(DataFactory& dataFactory, const std::string& texturePath);
+	// rgb cubemap from the +x, -x, +y, -y, +z and -z faces. the faces are uploaded together once all of them are decoded
+	GLuint LoadCubemapTexture(DataFactory& dataFactory, const std::vector<std::string>& texturePaths);
+
+	// uploads the textures whose images finished decoding since the last call
+	void Update();
+	bool IsBusy() const { return !m_pending.empty(); }
+	size_t GetPendingCount() const { return m_pending.size(); }
+
+	// decodes an image file into rows of the given channel count, flipped so the first row is the bottom one if asked.
+	// safe to call from any thread
+	static TextureImage DecodeImage(const std::string& texturePath, int channels, bool flipVertically);
+
+private:
+	struct PendingTexture {
+		GLuint textureID;
+		GLenum target; // GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+		std::vector<std::string> paths;
+		std::vector<std::future<TextureImage>> images; // one per file, in the order of the paths
+	};
+
+	static bool IsReady(const PendingTexture& pending);
+	// returns the bytes uploaded
+	static size_t Upload(PendingTexture& pending);
+
+	std::vector<PendingTexture> m_pending; // in the order they were requested
+};
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cstring>
+#include "upload_ring.h"
+
+//allocations start on cache lines, which also satisfies the alignment every pixel type needs
+static const size_t ALLOCATION_ALIGNMENT = 64;
+static const size_t BUFFER_SIZE = UploadRing::SEGMENT_COUNT * UploadRing::SEGMENT_SIZE;
+
+UploadRing& UploadRing::Get() {
+	static UploadRing uploadRing;
+	return uploadRing;
+}
+
+void UploadRing::Create() {
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+	//glad only loads glBufferStorage when the context is 4.4 or newer
+	m_persistent = GLAD_GL_VERSION_4_4 && glBufferStorage;
+	if (m_persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, BUFFER_SIZE, nullptr, flags);
+		m_mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, BUFFER_SIZE, flags));
+		m_persistent = m_mapped != nullptr;
+	}
+	if (!m_persistent) {
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, BUFFER_SIZE, nullptr, GL_STREAM_DRAW);
+	}
+	m_segment = 0;
+	m_offset = 0;
+}
+
+//the GPU usually finished with a segment long ago, a fence that hasn't signaled yet is the stall the ring is sized to avoid
+void UploadRing::WaitForSegment(int segment) {
+	GLsync fence = m_fences[segment];
+	if (!fence) {
+		return;
+	}
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		m_frameStats.stalls++;
+		const GLuint64 timeout = 1000000000; // 1s, a fence is only left waiting when the context is lost
+		do {
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		} while (status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fence);
+	m_fences[segment] = nullptr;
+}
+
+size_t UploadRing::Allocate(size_t bytes) {
+	size_t offset = (m_offset + ALLOCATION_ALIGNMENT - 1) / ALLOCATION_ALIGNMENT * ALLOCATION_ALIGNMENT;
+	if (m_persistent) {
+		if (offset + bytes > (m_segment + 1) * SEGMENT_SIZE) {
+			m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_segment = (m_segment + 1) % SEGMENT_COUNT;
+			WaitForSegment(m_segment);
+			offset = m_segment * SEGMENT_SIZE;
+		}
+	}
+	else if (offset + bytes > BUFFER_SIZE) {
+		//orphaning, the driver hands out new storage while the old one is still read by pending uploads
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, BUFFER_SIZE, nullptr, GL_STREAM_DRAW);
+		offset = 0;
+	}
+	m_offset = offset + bytes;
+	return offset;
+}
+
+//uploads are split into bands of rows that fit a segment. the rows are packed tightly in the ring, whatever the stride of
+//the source
+void UploadRing::UploadTexture2D(GLenum target, int x, int y, int width, int height, GLenum format, GLenum type, int texelSize, const void* data, int stride) {
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+	if (m_buffer == 0) {
+		Create();
+	}
+
+	size_t rowBytes = size_t(width) * texelSize;
+	size_t sourceRowBytes = size_t(stride) * texelSize;
+	int rowsPerBand = int(std::min(size_t(height), SEGMENT_SIZE / rowBytes));
+	const uint8_t* source = static_cast<const uint8_t*>(data);
+	if (rowsPerBand == 0) {
+		//a single row larger than a segment, never the case for heightmaps
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+		glTexSubImage2D(target, 0, x, y, width, height, format, type, data);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		return;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int row = 0; row < height; row += rowsPerBand) {
+		int rows = std::min(rowsPerBand, height - row);
+		size_t bytes = rowBytes * rows;
+		size_t offset = Allocate(bytes);
+		uint8_t* destination = m_persistent ? m_mapped + offset : static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+			offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+		if (!destination) {
+			break;
+		}
+
+		const uint8_t* sourceRows = source + row * sourceRowBytes;
+		if (sourceRowBytes == rowBytes) {
+			std::memcpy(destination, sourceRows, bytes);
+		}
+		else {
+			for (int i = 0; i < rows; i++) {
+				std::memcpy(destination + i * rowBytes, sourceRows + i * sourceRowBytes, rowBytes);
+			}
+		}
+		if (!m_persistent) {
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+
+		//with an unpack buffer bound the pointer is an offset into it
+		glTexSubImage2D(target, 0, x, y + row, width, rows, format, type, reinterpret_cast<const void*>(offset));
+		m_frameStats.bytes += bytes;
+		m_frameStats.uploads++;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void UploadRing::EndFrame() {
+	m_lastFrameStats = m_frameStats;
+	m_frameStats = UploadRingStats();
+}
+
+void UploadRing::Destroy() {
+	for (GLsync& fence : m_fences) {
+		if (fence) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (m_buffer != 0) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+		if (m_mapped) {
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			m_mapped = nullptr;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+}
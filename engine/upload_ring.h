@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+
+struct UploadRingStats {
+	size_t bytes = 0;
+	int uploads = 0; // glTexSubImage2D calls, large uploads are split into several
+	int stalls = 0; // times the CPU had to wait for the GPU to be done with a segment
+};
+
+// Streams texture uploads through a ring of pixel unpack buffer memory, so glTexSubImage2D copies from buffer memory
+// the driver can DMA from instead of stalling on client memory while earlier draws still sample the texture.
+//
+// With GL 4.4 the ring is one persistently mapped buffer split into SEGMENT_COUNT segments. A fence is placed when the
+// writes move on from a segment and waited on before the segment is written again, which only blocks when the GPU is
+// SEGMENT_COUNT segments behind. Without it the buffer is mapped unsynchronized for every upload and orphaned when it
+// runs full, which leaves the synchronization to the driver.
+class UploadRing {
+public:
+	static const int SEGMENT_COUNT = 4;
+	static const size_t SEGMENT_SIZE = 8 * 1024 * 1024; // the most a single glTexSubImage2D takes from the ring
+
+	static UploadRing& Get();
+
+	//prevent copying
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+
+	// uploads rows of texels into level 0 of the texture bound on the active unit. target is GL_TEXTURE_2D or a cubemap
+	// face. stride is in texels. the rows are copied into the ring before returning, so the data can change right after
+	void UploadTexture2D(GLenum target, int x, int y, int width, int height, GLenum format, GLenum type, int texelSize, const void* data, int stride);
+
+	// publishes the counts of the frame and starts counting the next one
+	void EndFrame();
+	const UploadRingStats& GetLastFrameStats() const { return m_lastFrameStats; }
+	bool IsPersistent() const { return m_persistent; }
+
+	void Destroy();
+
+private:
+	UploadRing() = default;
+
+	void Create();
+	// offset of room for the bytes, after the last allocation or at the start of the next segment
+	size_t Allocate(size_t bytes);
+	void WaitForSegment(int segment);
+
+	GLuint m_buffer = 0; // created by the first upload, there is a GL context by then
+	uint8_t* m_mapped = nullptr; // the persistent mapping
+	bool m_persistent = false;
+	GLsync m_fences[SEGMENT_COUNT] = {};
+	int m_segment = 0;
+	size_t m_offset = 0; // end of the last allocation
+
+	UploadRingStats m_frameStats;
+	UploadRingStats m_lastFrameStats;
+};
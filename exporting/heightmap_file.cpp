@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <stb/stb_image.h>
+#include "heightmap_file.h"
+#include "../util/mapped_file.h"
+#include "../util/thread_pool.h"
+
+static const char NATIVE_MAGIC[4] = { 'T', 'S', 'H', 'M' };
+static const uint32_t NATIVE_VERSION = 1;
+
+//heights follow the header as resolution * resolution little endian floats, row by row
+struct NativeHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t headerSize;
+    int32_t resolution;
+    float size;
+    float noiseSeed;
+    float amplitude;
+    float frequency;
+    float minHeight;
+    float maxHeight;
+    uint8_t reserved[24];
+};
+static_assert(sizeof(NativeHeader) == 64, "the header is part of the file format");
+
+static size_t GetTexelCount(int resolution) {
+    return size_t(resolution) * resolution;
+}
+
+static bool WriteFile(const std::string& filePath, const void* data, size_t byteCount) {
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error trying to open file for writing: " << filePath << std::endl;
+        return false;
+    }
+    file.write(static_cast<const char*>(data), byteCount);
+    file.close();
+    if (file.fail()) {
+        std::cerr << "Error writing to file: " << filePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool HeightmapFile::SaveNative(const Heightmap& heightmap, const std::string& filePath) {
+    NativeHeader header = {};
+    std::memcpy(header.magic, NATIVE_MAGIC, sizeof(NATIVE_MAGIC));
+    header.version = NATIVE_VERSION;
+    header.headerSize = sizeof(NativeHeader);
+    header.resolution = int(heightmap.GetResolution());
+    header.size = heightmap.GetSize();
+    header.noiseSeed = heightmap.GetNoiseSeed();
+    header.amplitude = heightmap.Amplitude;
+    header.frequency = heightmap.Frequency;
+    header.minHeight = heightmap.GetMinHeight();
+    header.maxHeight = heightmap.GetMaxHeight();
+
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error trying to open file for writing: " << filePath << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(heightmap.GetHeights()), GetTexelCount(header.resolution) * sizeof(float));
+    file.close();
+    if (file.fail()) {
+        std::cerr << "Error writing to file: " << filePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//the heights are copied straight out of the mapping into the heightmap, nothing is parsed
+std::shared_ptr<Heightmap> HeightmapFile::LoadNative(const std::string& filePath) {
+    util::MappedFile file;
+    if (!file.Open(filePath)) {
+        std::cerr << "Error trying to open file for reading: " << filePath << std::endl;
+        return nullptr;
+    }
+
+    NativeHeader header;
+    if (file.GetSize() < sizeof(header)) {
+        std::cerr << "Not a TerraSim heightmap: " << filePath << std::endl;
+        return nullptr;
+    }
+    std::memcpy(&header, file.GetData(), sizeof(header));
+    if (std::memcmp(header.magic, NATIVE_MAGIC, sizeof(NATIVE_MAGIC)) != 0 || header.headerSize < sizeof(header)) {
+        std::cerr << "Not a TerraSim heightmap: " << filePath << std::endl;
+        return nullptr;
+    }
+    if (header.version > NATIVE_VERSION) {
+        std::cerr << "Heightmap was saved by a newer version (" << header.version << "): " << filePath << std::endl;
+        return nullptr;
+    }
+    if (header.resolution < 2 || file.GetSize() != header.headerSize + GetTexelCount(header.resolution) * sizeof(float)) {
+        std::cerr << "Heightmap file is truncated or corrupt: " << filePath << std::endl;
+        return nullptr;
+    }
+
+    //the header size is a multiple of 4 and mappings start on a page, so the heights are aligned for float reads
+    const float* heights = reinterpret_cast<const float*>(file.GetData() + header.headerSize);
+    std::shared_ptr<Heightmap> heightmap = std::make_shared<Heightmap>(header.size, header.resolution);
+    heightmap->SetHeights(heights, header.minHeight, header.maxHeight);
+    heightmap->SetNoiseSeed(header.noiseSeed);
+    heightmap->Amplitude = header.amplitude;
+    heightmap->Frequency = header.frequency;
+    return heightmap;
+}
+
+//maps the height range of the heightmap to [0, 65535]
+void HeightmapFile::Quantize(const Heightmap& heightmap, std::unique_ptr<uint16_t[]>& values) {
+    int resolution = int(heightmap.GetResolution());
+    const float* heights = heightmap.GetHeights();
+    float minHeight = heightmap.GetMinHeight();
+    float range = heightmap.GetMaxHeight() - minHeight;
+    float scale = range > 0.f ? 65535.f / range : 0.f;
+
+    values = std::make_unique<uint16_t[]>(GetTexelCount(resolution));
+    util::ThreadPool::Get().ParallelFor(0, resolution, 64, [&](int rowBegin, int rowEnd) {
+        for (size_t i = size_t(rowBegin) * resolution; i < size_t(rowEnd) * resolution; i++) {
+            float value = std::round((heights[i] - minHeight) * scale);
+            values[i] = uint16_t(std::clamp(value, 0.f, 65535.f));
+        }
+    });
+}
+
+std::shared_ptr<Heightmap> HeightmapFile::Dequantize(const uint16_t* values, int resolution, float minHeight, float maxHeight) {
+    std::vector<float> heights(GetTexelCount(resolution));
+    float scale = (maxHeight - minHeight) / 65535.f;
+    util::ThreadPool::Get().ParallelFor(0, resolution, 64, [&](int rowBegin, int rowEnd) {
+        for (size_t i = size_t(rowBegin) * resolution; i < size_t(rowEnd) * resolution; i++) {
+            heights[i] = minHeight + values[i] * scale;
+        }
+    });
+
+    //the terrain is two texels per world unit, like a generated one
+    std::shared_ptr<Heightmap> heightmap = std::make_shared<Heightmap>(resolution * .5f, resolution);
+    heightmap->SetHeights(heights.data());
+    heightmap->Amplitude = maxHeight;
+    return heightmap;
+}
+
+//RAW16 is the bare grid of little endian 16 bit values, the resolution follows from the file size
+bool HeightmapFile::ExportRaw16(const Heightmap& heightmap, const std::string& filePath) {
+    std::unique_ptr<uint16_t[]> values;
+    Quantize(heightmap, values);
+    return WriteFile(filePath, values.get(), GetTexelCount(int(heightmap.GetResolution())) * sizeof(uint16_t));
+}
+
+std::shared_ptr<Heightmap> HeightmapFile::ImportRaw16(const std::string& filePath, float minHeight, float maxHeight) {
+    util::MappedFile file;
+    if (!file.Open(filePath)) {
+        std::cerr << "Error trying to open file for reading: " << filePath << std::endl;
+        return nullptr;
+    }
+
+    size_t valueCount = file.GetSize() / sizeof(uint16_t);
+    int resolution = int(std::lround(std::sqrt(double(valueCount))));
+    if (file.GetSize() % sizeof(uint16_t) != 0 || resolution < 2 || GetTexelCount(resolution) != valueCount) {
+        std::cerr << "RAW16 heightmap has to be a square grid of 16 bit values: " << filePath << std::endl;
+        return nullptr;
+    }
+    return Dequantize(reinterpret_cast<const uint16_t*>(file.GetData()), resolution, minHeight, maxHeight);
+}
+
+static uint32_t Crc32(const unsigned char* data, size_t length) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> entries;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; bit++) {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            entries[i] = value;
+        }
+        return entries;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void AppendBigEndian(std::vector<unsigned char>& buffer, uint32_t value) {
+    buffer.push_back(uint8_t(value >> 24));
+    buffer.push_back(uint8_t(value >> 16));
+    buffer.push_back(uint8_t(value >> 8));
+    buffer.push_back(uint8_t(value));
+}
+
+static void AppendPngChunk(std::vector<unsigned char>& png, const char type[4], const unsigned char* data, size_t length) {
+    AppendBigEndian(png, uint32_t(length));
+    size_t typeStart = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data, data + length);
+    AppendBigEndian(png, Crc32(&png[typeStart], length + 4));
+}
+
+static uint32_t Adler32(const unsigned char* data, size_t length) {
+    uint32_t a = 1, b = 0;
+    while (length > 0) {
+        //5552 bytes is the most that can be summed before b has to be reduced
+        size_t blockLength = std::min(length, size_t(5552));
+        for (size_t i = 0; i < blockLength; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += blockLength;
+        length -= blockLength;
+    }
+    return (b << 16) | a;
+}
+
+//zlib stream of stored deflate blocks. the low bytes of 16 bit heights are close to random, so real compression
+//only saves a few percent and would take longer than writing the file
+static void AppendStoredZlib(std::vector<unsigned char>& buffer, const unsigned char* data, size_t length) {
+    const size_t maxBlockLength = 65535;
+    buffer.reserve(buffer.size() + length + (length / maxBlockLength + 1) * 5 + 6);
+    buffer.push_back(0x78); //deflate with a 32k window
+    buffer.push_back(0x01); //no dictionary, check bits
+
+    size_t offset = 0;
+    do {
+        size_t blockLength = std::min(length - offset, maxBlockLength);
+        bool finalBlock = offset + blockLength == length;
+        buffer.push_back(finalBlock ? 1 : 0);
+        buffer.push_back(uint8_t(blockLength));
+        buffer.push_back(uint8_t(blockLength >> 8));
+        buffer.push_back(uint8_t(~blockLength));
+        buffer.push_back(uint8_t(~blockLength >> 8));
+        buffer.insert(buffer.end(), data + offset, data + offset + blockLength);
+        offset += blockLength;
+    } while (offset < length);
+
+    AppendBigEndian(buffer, Adler32(data, length));
+}
+
+//single channel 16 bit PNG without filtering
+bool HeightmapFile::ExportPng16(const Heightmap& heightmap, const std::string& filePath) {
+    int resolution = int(heightmap.GetResolution());
+    std::unique_ptr<uint16_t[]> values;
+    Quantize(heightmap, values);
+
+    //every row starts with its filter type, and png samples are big endian
+    size_t rowBytes = 1 + size_t(resolution) * 2;
+    std::vector<unsigned char> rows(rowBytes * resolution);
+    util::ThreadPool::Get().ParallelFor(0, resolution, 64, [&](int rowBegin, int rowEnd) {
+        for (int z = rowBegin; z < rowEnd; z++) {
+            unsigned char* row = &rows[z * rowBytes];
+            const uint16_t* source = &values[size_t(z) * resolution];
+            row[0] = 0;
+            for (int x = 0; x < resolution; x++) {
+                row[1 + x * 2] = uint8_t(source[x] >> 8);
+                row[2 + x * 2] = uint8_t(source[x]);
+            }
+        }
+    });
+
+    std::vector<unsigned char> imageData;
+    AppendStoredZlib(imageData, rows.data(), rows.size());
+
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> header;
+    AppendBigEndian(header, uint32_t(resolution));
+    AppendBigEndian(header, uint32_t(resolution));
+    header.insert(header.end(), { 16, 0, 0, 0, 0 }); //bit depth, grayscale, deflate, adaptive filtering, no interlacing
+    AppendPngChunk(png, "IHDR", header.data(), header.size());
+    AppendPngChunk(png, "IDAT", imageData.data(), imageData.size());
+    AppendPngChunk(png, "IEND", nullptr, 0);
+
+    return WriteFile(filePath, png.data(), png.size());
+}
+
+std::shared_ptr<Heightmap> HeightmapFile::ImportPng16(const std::string& filePath, float minHeight, float maxHeight) {
+    //8 bit images are widened to 16 bits by stb, so they import as well
+    stbi_set_flip_vertically_on_load(0);
+    int width, height, channels;
+    stbi_us* values = stbi_load_16(filePath.c_str(), &width, &height, &channels, 1);
+    if (!values) {
+        std::cerr << "Error loading heightmap image: " << filePath << " - " << stbi_failure_reason() << std::endl;
+        return nullptr;
+    }
+    if (width != height || width < 2) {
+        std::cerr << "Heightmap image has to be square: " << filePath << std::endl;
+        stbi_image_free(values);
+        return nullptr;
+    }
+
+    std::shared_ptr<Heightmap> heightmap = Dequantize(values, width, minHeight, maxHeight);
+    stbi_image_free(values);
+    return heightmap;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "../terrain/heightmap.h"
+
+// Saves and loads heightmaps without going through a mesh.
+//
+// The native .tsh file is a 64 byte header followed by the float grid exactly as the heightmap stores it, so loading
+// is one copy out of a memory mapped file. 16 bit PNG and RAW16 files are the formats other terrain tools exchange,
+// their heights are normalized to the full 16 bit range.
+class HeightmapFile {
+public:
+	// returns false if the file couldn't be written
+	static bool SaveNative(const Heightmap& heightmap, const std::string& filePath);
+	static bool ExportPng16(const Heightmap& heightmap, const std::string& filePath);
+	static bool ExportRaw16(const Heightmap& heightmap, const std::string& filePath);
+
+	// returns nullptr if the file couldn't be read. 16 bit values are mapped to [minHeight, maxHeight], the files only
+	// store the shape of the terrain, not its scale
+	static std::shared_ptr<Heightmap> LoadNative(const std::string& filePath);
+	static std::shared_ptr<Heightmap> ImportPng16(const std::string& filePath, float minHeight, float maxHeight);
+	static std::shared_ptr<Heightmap> ImportRaw16(const std::string& filePath, float minHeight, float maxHeight);
+
+private:
+	static void Quantize(const Heightmap& heightmap, std::unique_ptr<uint16_t[]>& values);
+	static std::shared_ptr<Heightmap> Dequantize(const uint16_t* values, int resolution, float minHeight, float maxHeight);
+};
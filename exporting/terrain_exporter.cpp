@@ -0,0 +1,276 @@
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include <glm/glm.hpp>
+#include "terrain_exporter.h"
+#include "../util/thread_pool.h"
+
+//bytes a single task formats before its band is written. a band holds as many rows as fit, at least one, so the memory
+//held by a batch of bands is the same whatever the resolution
+static const size_t BAND_BYTES = 256 * 1024;
+
+//longest text std::to_chars produces for a float (shortest round trip, like "-1.17549435e-38") and an int
+static const int MAX_FLOAT_CHARS = 15;
+static const int MAX_INT_CHARS = 11;
+
+//formats rows [0, rowCount) in bands on the thread pool and writes the bands to the file in order. rowBytes is the most
+//a row can take once formatted. only a batch of bands is held in memory at a time, and their buffers are reused by the
+//next batch
+static bool WriteRowBands(std::ostream& file, int rowCount, size_t rowBytes, const std::function<void(int, std::vector<char>&)>& formatRow,
+                          std::atomic<float>& progress, float progressStart, float progressEnd) {
+    util::ThreadPool& threadPool = util::ThreadPool::Get();
+    int rowsPerBand = int(std::max<size_t>(1, BAND_BYTES / std::max<size_t>(rowBytes, 1)));
+    int bandCount = (rowCount + rowsPerBand - 1) / rowsPerBand;
+    int bandsPerBatch = int(threadPool.GetThreadCount() + 1) * 2;
+    std::vector<std::vector<char>> bandBuffers(bandsPerBatch);
+
+    for (int batchStart = 0; batchStart < bandCount; batchStart += bandsPerBatch) {
+        int batchEnd = std::min(batchStart + bandsPerBatch, bandCount);
+
+        threadPool.ParallelFor(batchStart, batchEnd, 1, [&](int bandBegin, int bandEnd) {
+            for (int band = bandBegin; band < bandEnd; band++) {
+                std::vector<char>& buffer = bandBuffers[band - batchStart];
+                buffer.clear();
+                int rowEnd = std::min((band + 1) * rowsPerBand, rowCount);
+                for (int row = band * rowsPerBand; row < rowEnd; row++) {
+                    formatRow(row, buffer);
+                }
+            }
+        });
+
+        for (int band = batchStart; band < batchEnd; band++) {
+            const std::vector<char>& buffer = bandBuffers[band - batchStart];
+            file.write(buffer.data(), buffer.size());
+        }
+        if (!file) {
+            return false;
+        }
+
+        progress = progressStart + (progressEnd - progressStart) * float(batchEnd) / bandCount;
+    }
+    return true;
+}
+
+template<typename T>
+static void AppendBinary(std::vector<char>& buffer, const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+//the number is written to [first, first + MAX_FLOAT_CHARS), the line buffers leave that much room for every number on
+//the line. a number that doesn't fit is left out rather than written past the buffer
+static char* FormatFloat(char* first, float value) {
+    std::to_chars_result result = std::to_chars(first, first + MAX_FLOAT_CHARS, value);
+    return result.ec == std::errc() ? result.ptr : first;
+}
+
+static char* FormatInt(char* first, int value) {
+    std::to_chars_result result = std::to_chars(first, first + MAX_INT_CHARS, value);
+    return result.ec == std::errc() ? result.ptr : first;
+}
+
+static glm::vec3 GetGridPosition(const Heightmap& heightmap, int x, int z) {
+    int resolution = int(heightmap.GetResolution());
+    float step = (2.f * heightmap.GetSize()) / (resolution - 1);
+    return glm::vec3(-heightmap.GetSize() + x * step, heightmap.GetHeight(x, z), -heightmap.GetSize() + z * step);
+}
+
+//corners of the two triangles of the grid quad at (column, row), as indices into the row major vertex grid
+static void GetQuadTriangles(int resolution, int row, int column, int triangles[2][3]) {
+    int topLeft = row * resolution + column;
+    int topRight = topLeft + 1;
+    int bottomLeft = topLeft + resolution;
+    int bottomRight = bottomLeft + 1;
+
+    triangles[0][0] = topLeft;
+    triangles[0][1] = bottomLeft;
+    triangles[0][2] = topRight;
+    triangles[1][0] = topRight;
+    triangles[1][1] = bottomLeft;
+    triangles[1][2] = bottomRight;
+}
+
+bool TerrainExporter::Export(const Heightmap& heightmap, const std::string& filePath, ExportFormat format, std::atomic<float>& progress) {
+    progress = 0.f;
+
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error trying to open file for writing: " << filePath << std::endl;
+        return false;
+    }
+
+    bool written = false;
+    if (format == ExportFormat::Obj) {
+        written = WriteObj(heightmap, file, progress);
+    }
+    else if (format == ExportFormat::BinaryPly) {
+        written = WritePly(heightmap, file, progress);
+    }
+    else {
+        written = WriteStl(heightmap, file, progress);
+    }
+
+    file.close();
+    if (!written || file.fail()) {
+        std::cerr << "Error writing to file: " << filePath << std::endl;
+        return false;
+    }
+
+    progress = 1.f;
+    return true;
+}
+
+const char* TerrainExporter::GetExtension(ExportFormat format) {
+    if (format == ExportFormat::Obj) {
+        return "obj";
+    }
+    if (format == ExportFormat::BinaryPly) {
+        return "ply";
+    }
+    return "stl";
+}
+
+bool TerrainExporter::WriteObj(const Heightmap& heightmap, std::ostream& file, std::atomic<float>& progress) {
+    int resolution = int(heightmap.GetResolution());
+    int quadsPerSide = resolution - 1;
+
+    //progress is split by the number of lines in each part
+    float vertexShare = float(resolution) * resolution / (float(resolution) * resolution + 2.f * quadsPerSide * quadsPerSide);
+
+    //"v x y z\n" and "vt s t\n" per vertex, "f a/a b/b c/c\n" twice per quad
+    const size_t vertexLineBytes = 5 + 3 * MAX_FLOAT_CHARS;
+    const size_t textureLineBytes = 5 + 2 * MAX_FLOAT_CHARS;
+    const size_t faceLineBytes = 2 + 3 * (2 + 2 * MAX_INT_CHARS);
+
+    bool written = WriteRowBands(file, resolution, resolution * (vertexLineBytes + textureLineBytes), [&](int z, std::vector<char>& buffer) {
+        char line[vertexLineBytes];
+        for (int x = 0; x < resolution; x++) {
+            glm::vec3 position = GetGridPosition(heightmap, x, z);
+            char* end = line;
+            *end++ = 'v';
+            *end++ = ' ';
+            end = FormatFloat(end, position.x);
+            *end++ = ' ';
+            end = FormatFloat(end, position.y);
+            *end++ = ' ';
+            end = FormatFloat(end, position.z);
+            *end++ = '\n';
+            buffer.insert(buffer.end(), line, end);
+
+            end = line;
+            *end++ = 'v';
+            *end++ = 't';
+            *end++ = ' ';
+            end = FormatFloat(end, float(x) / quadsPerSide);
+            *end++ = ' ';
+            end = FormatFloat(end, float(z) / quadsPerSide);
+            *end++ = '\n';
+            buffer.insert(buffer.end(), line, end);
+        }
+    }, progress, 0.f, vertexShare);
+
+    if (!written) {
+        return false;
+    }
+
+    return WriteRowBands(file, quadsPerSide, quadsPerSide * 2 * faceLineBytes, [&](int row, std::vector<char>& buffer) {
+        char line[faceLineBytes];
+        int triangles[2][3];
+        for (int column = 0; column < quadsPerSide; column++) {
+            GetQuadTriangles(resolution, row, column, triangles);
+            for (const int* corners : triangles) {
+                char* end = line;
+                *end++ = 'f';
+                for (int corner = 0; corner < 3; corner++) {
+                    //obj indices start at 1, and every vertex has the texture coordinate of the same index
+                    *end++ = ' ';
+                    end = FormatInt(end, corners[corner] + 1);
+                    *end++ = '/';
+                    end = FormatInt(end, corners[corner] + 1);
+                }
+                *end++ = '\n';
+                buffer.insert(buffer.end(), line, end);
+            }
+        }
+    }, progress, vertexShare, 1.f);
+}
+
+//binary data is written in the byte order of the machine, which is little endian on every platform this runs on
+bool TerrainExporter::WritePly(const Heightmap& heightmap, std::ostream& file, std::atomic<float>& progress) {
+    int resolution = int(heightmap.GetResolution());
+    int quadsPerSide = resolution - 1;
+
+    file << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "comment TerraSim terrain\n"
+         << "element vertex " << resolution * resolution << "\n"
+         << "property float x\n"
+         << "property float y\n"
+         << "property float z\n"
+         << "property float s\n"
+         << "property float t\n"
+         << "element face " << 2 * quadsPerSide * quadsPerSide << "\n"
+         << "property list uchar int vertex_indices\n"
+         << "end_header\n";
+
+    bool written = WriteRowBands(file, resolution, resolution * 5 * sizeof(float), [&](int z, std::vector<char>& buffer) {
+        for (int x = 0; x < resolution; x++) {
+            glm::vec3 position = GetGridPosition(heightmap, x, z);
+            float vertex[5] = { position.x, position.y, position.z, float(x) / quadsPerSide, float(z) / quadsPerSide };
+            AppendBinary(buffer, vertex);
+        }
+    }, progress, 0.f, .5f);
+
+    if (!written) {
+        return false;
+    }
+
+    return WriteRowBands(file, quadsPerSide, quadsPerSide * 2 * (1 + 3 * sizeof(int)), [&](int row, std::vector<char>& buffer) {
+        int triangles[2][3];
+        for (int column = 0; column < quadsPerSide; column++) {
+            GetQuadTriangles(resolution, row, column, triangles);
+            for (const int* corners : triangles) {
+                buffer.push_back(3);
+                AppendBinary(buffer, corners[0]);
+                AppendBinary(buffer, corners[1]);
+                AppendBinary(buffer, corners[2]);
+            }
+        }
+    }, progress, .5f, 1.f);
+}
+
+//normal, three corners and an unused attribute
+static const size_t STL_TRIANGLE_BYTES = 4 * sizeof(glm::vec3) + sizeof(uint16_t);
+
+bool TerrainExporter::WriteStl(const Heightmap& heightmap, std::ostream& file, std::atomic<float>& progress) {
+    int resolution = int(heightmap.GetResolution());
+    int quadsPerSide = resolution - 1;
+
+    char header[80] = {};
+    const char title[] = "TerraSim terrain";
+    std::memcpy(header, title, sizeof(title) - 1);
+    file.write(header, sizeof(header));
+    uint32_t triangleCount = uint32_t(2) * quadsPerSide * quadsPerSide;
+    file.write(reinterpret_cast<const char*>(&triangleCount), sizeof(triangleCount));
+
+    return WriteRowBands(file, quadsPerSide, quadsPerSide * 2 * STL_TRIANGLE_BYTES, [&](int row, std::vector<char>& buffer) {
+        int triangles[2][3];
+        for (int column = 0; column < quadsPerSide; column++) {
+            GetQuadTriangles(resolution, row, column, triangles);
+            for (const int* corners : triangles) {
+                glm::vec3 vertices[3];
+                for (int corner = 0; corner < 3; corner++) {
+                    vertices[corner] = GetGridPosition(heightmap, corners[corner] % resolution, corners[corner] / resolution);
+                }
+                glm::vec3 normal = glm::normalize(glm::cross(vertices[1] - vertices[0], vertices[2] - vertices[0]));
+
+                AppendBinary(buffer, normal);
+                AppendBinary(buffer, vertices);
+                AppendBinary(buffer, uint16_t(0));
+            }
+        }
+    }, progress, 0.f, 1.f);
+}
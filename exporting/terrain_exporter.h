@@ -0,0 +1,27 @@
+#pragma once
+#include <atomic>
+#include <ostream>
+#include <string>
+#include "../terrain/heightmap.h"
+
+enum class ExportFormat {
+	Obj,       // Wavefront text, positions and texture coordinates
+	BinaryPly, // little endian PLY, positions and texture coordinates
+	BinaryStl  // triangles with face normals, no shared vertices
+};
+
+// Writes the full resolution terrain grid to a mesh file. Rows of the grid are formatted in bands of a fixed byte budget
+// on the thread pool and streamed to the file a batch of bands at a time, so memory use doesn't grow with the size of
+// the terrain.
+class TerrainExporter {
+public:
+	// progress goes from 0 to 1 while the file is written. returns false if the file couldn't be written
+	static bool Export(const Heightmap& heightmap, const std::string& filePath, ExportFormat format, std::atomic<float>& progress);
+
+	static const char* GetExtension(ExportFormat format);
+
+private:
+	static bool WriteObj(const Heightmap& heightmap, std::ostream& file, std::atomic<float>& progress);
+	static bool WritePly(const Heightmap& heightmap, std::ostream& file, std::atomic<float>& progress);
+	static bool WriteStl(const Heightmap& heightmap, std::ostream& file, std::atomic<float>& progress);
+};
@@ -5,6 +5,11 @@
 struct Raycaster {
 
 	glm::vec3 static GetRaycastFromCameraToTerrain(glm::vec3 cameraPos, Terrain& terrain, float ndcX, float ndcY, glm::mat4 projectionMatrix, glm::mat4 viewMatrix) {
+		glm::vec3 rayDirection = GetRayDirection(ndcX, ndcY, projectionMatrix, viewMatrix);
+		return RaycastHeightPyramid(cameraPos, rayDirection, *terrain.GetHeightmap(), terrain.GetHeightPyramid());
+	}
+
+	glm::vec3 static GetRayDirection(float ndcX, float ndcY, glm::mat4 projectionMatrix, glm::mat4 viewMatrix) {
 		glm::vec4 clipSpaceCoords(ndcX, ndcY, -1.f, 1.f);
 		glm::mat4 inverseProjection = glm::inverse(projectionMatrix);
 		glm::vec4 viewSpaceCoords = inverseProjection * clipSpaceCoords; //unproject the screen space coordinates to get view space
@@ -13,17 +18,30 @@ struct Raycaster {
 
 		glm::mat4 inverseView = glm::inverse(viewMatrix);
 		glm::vec4 worldCoords = inverseView * viewSpaceCoords;
-		glm::vec3 rayDirection = glm::normalize(glm::vec3(worldCoords)); //go from view space to world space to get mouse ray direction'
+		return glm::normalize(glm::vec3(worldCoords)); //go from view space to world space to get mouse ray direction'
+	}
+
+	// exact first hit on the terrain surface, found by walking the min/max height pyramid
+	glm::vec3 static RaycastHeightPyramid(glm::vec3 rayOrigin, glm::vec3 rayDirection, const Heightmap& heightmap, const HeightPyramid& heightPyramid) {
+		float hitDistance;
+		if (heightPyramid.Raycast(heightmap, rayOrigin, rayDirection, hitDistance)) {
+			return rayOrigin + rayDirection * hitDistance;
+		}
+		return glm::vec3(std::numeric_limits<float>::max());
+	}
 
+	// the original sphere tracing marcher. steps by the vertical distance to the texel below the ray.
+	// kept as the reference the pyramid raycast is benchmarked against
+	glm::vec3 static MarchRay(glm::vec3 rayOrigin, glm::vec3 rayDirection, const Heightmap& heightmap) {
 		int maxSteps = 2000;
 		float epsilon = 0.001f;
 
 		// cast a ray from camera to first object. using ray marching algorithm
-		glm::vec3 currentPosition = cameraPos;
+		glm::vec3 currentPosition = rayOrigin;
 		glm::vec3 intersectionPoint = glm::vec3(std::numeric_limits<float>::max());
 		for (int i = 0; i < maxSteps; i++) {
 
-			float distanceToTerrain = currentPosition.y - terrain.GetHeightFromWorld(currentPosition.x, currentPosition.z);
+			float distanceToTerrain = currentPosition.y - heightmap.GetHeightFromWorld(currentPosition.x, currentPosition.z);
 
 			// march ray
 			currentPosition += rayDirection * distanceToTerrain;
@@ -37,4 +55,4 @@ struct Raycaster {
 
 		return glm::vec3(std::numeric_limits<float>::max());
 	}
-};
\ No newline at end of file
+};
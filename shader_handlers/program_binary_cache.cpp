@@ -0,0 +1,108 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "program_binary_cache.h"
+
+const char* ProgramBinaryCache::DIRECTORY = "shader_cache";
+
+static const uint32_t FILE_MAGIC = 0x42505354; // "TSPB"
+static const uint32_t FILE_VERSION = 1; // bumped whenever the layout of the files changes
+
+struct ProgramBinaryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+//64 bit FNV-1a, a collision only costs a binary the driver rejects
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+//the terminating zero is hashed too, so the strings can't run into each other
+static uint64_t HashString(uint64_t hash, const char* string) {
+    return HashBytes(hash, string ? string : "", (string ? std::strlen(string) : 0) + 1);
+}
+
+static std::string GetFilePath(const std::string& name) {
+    return std::string(ProgramBinaryCache::DIRECTORY) + "/" + name + ".bin";
+}
+
+bool ProgramBinaryCache::IsSupported() {
+    if (!GLAD_GL_VERSION_4_1 || !glGetProgramBinary || !glProgramBinary) {
+        return false;
+    }
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+uint64_t ProgramBinaryCache::GetKey(const std::string& vertexSource, const std::string& fragmentSource) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = HashString(hash, vertexSource.c_str());
+    hash = HashString(hash, fragmentSource.c_str());
+    hash = HashString(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    hash = HashString(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    hash = HashString(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    return hash;
+}
+
+bool ProgramBinaryCache::Load(GLuint program, const std::string& name, uint64_t key) {
+    std::ifstream file(GetFilePath(name), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    ProgramBinaryHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != FILE_MAGIC ||
+        header.version != FILE_VERSION || header.key != key || header.length == 0) {
+        return false;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) {
+        return false;
+    }
+
+    //a driver update that kept the version string can still reject the binary, that shows as a failed link
+    glProgramBinary(program, header.format, binary.data(), GLsizei(binary.size()));
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    return success != 0;
+}
+
+void ProgramBinaryCache::Store(GLuint program, const std::string& name, uint64_t key) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    //a cache that can't be written only means compiling again next launch
+    std::error_code error;
+    std::filesystem::create_directories(DIRECTORY, error);
+    std::ofstream file(GetFilePath(name), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error trying to open file for writing: " << GetFilePath(name) << std::endl;
+        return;
+    }
+    ProgramBinaryHeader header = { FILE_MAGIC, FILE_VERSION, key, format, uint32_t(length) };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    file.close();
+    if (file.fail()) {
+        std::cerr << "Error writing to file: " << GetFilePath(name) << std::endl;
+        std::filesystem::remove(GetFilePath(name), error);
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <glad/glad.h>
+
+// Linked programs saved with glGetProgramBinary and loaded with glProgramBinary on the next launch, which skips compiling
+// and linking their shaders. Every program has one file, named after it, that holds the binary together with a hash of the
+// shader sources and the driver strings. A file whose hash doesn't match, or a binary the driver rejects anyway, is
+// compiled from source as if there was no cache and then replaced.
+//
+// Program binaries are core since GL 4.1. On older contexts nothing is cached and every program is compiled
+class ProgramBinaryCache {
+public:
+	static const char* DIRECTORY;
+
+	static bool IsSupported();
+	// hash of both shader sources and the GL vendor, renderer and version, binaries are only valid for the driver that
+	// produced them
+	static uint64_t GetKey(const std::string& vertexSource, const std::string& fragmentSource);
+	// links the program from its cached binary, false if there is none for the key or the driver rejected it
+	static bool Load(GLuint program, const std::string& name, uint64_t key);
+	// the program has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	static void Store(GLuint program, const std::string& name, uint64_t key);
+};
@@ -1,26 +1,61 @@
+#include <cstring>
+#include <filesystem>
 #include "../util/util.h"
+#include "../engine/gl_state.h"
 #include "shader_handler.h"
+#include "program_binary_cache.h"
 
-//load and compile the vertex and fragment shader
+static UniformStats uniformStats;
+static ProgramCacheStats programCacheStats;
+
+//load the program from the binary cache, or compile and link the vertex and fragment shader and cache the result
 void ShaderHandler::LoadShaders(std::string vertexShaderFile, std::string fragmentShaderFile) {
-    m_vertexShaderID = CompileShader(GL_VERTEX_SHADER, vertexShaderFile);
-    m_fragmentShaderID = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderFile);
+    std::string vertexSource = util::read_file(vertexShaderFile);
+    std::string fragmentSource = util::read_file(fragmentShaderFile);
     m_shaderProgramID = glCreateProgram();
     if (m_shaderProgramID == 0) {
         util::fatal_error("Unable to create shader program\n", nullptr);
     }
 
-    glAttachShader(m_shaderProgramID, m_vertexShaderID);
-    glAttachShader(m_shaderProgramID, m_fragmentShaderID);
+    //the vertex shader names the program, unless the fragment shader is named differently
+    std::string cacheName = std::filesystem::path(vertexShaderFile).stem().string();
+    std::string fragmentName = std::filesystem::path(fragmentShaderFile).stem().string();
+    if (fragmentName != cacheName) {
+        cacheName += "_" + fragmentName;
+    }
+    bool cacheSupported = ProgramBinaryCache::IsSupported();
+    uint64_t cacheKey = cacheSupported ? ProgramBinaryCache::GetKey(vertexSource, fragmentSource) : 0;
 
     GLint success = 0;
     GLchar errorLog[1024] = { 0 };
 
-    glLinkProgram(m_shaderProgramID);
-    glGetProgramiv(m_shaderProgramID, GL_LINK_STATUS, &success);
-    if (success == 0) {
-        glGetProgramInfoLog(m_shaderProgramID, sizeof(errorLog), nullptr, errorLog);
-        util::fatal_error("Error linking shader program: '%s'\n", errorLog);
+    if (cacheSupported && ProgramBinaryCache::Load(m_shaderProgramID, cacheName, cacheKey)) {
+        programCacheStats.loaded++;
+    }
+    else {
+        //a rejected binary leaves the program unlinked, a new one starts from a clean slate
+        if (cacheSupported) {
+            glDeleteProgram(m_shaderProgramID);
+            m_shaderProgramID = glCreateProgram();
+        }
+        m_vertexShaderID = CompileShader(GL_VERTEX_SHADER, vertexSource, vertexShaderFile);
+        m_fragmentShaderID = CompileShader(GL_FRAGMENT_SHADER, fragmentSource, fragmentShaderFile);
+        glAttachShader(m_shaderProgramID, m_vertexShaderID);
+        glAttachShader(m_shaderProgramID, m_fragmentShaderID);
+        if (cacheSupported) {
+            glProgramParameteri(m_shaderProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        glLinkProgram(m_shaderProgramID);
+        glGetProgramiv(m_shaderProgramID, GL_LINK_STATUS, &success);
+        if (success == 0) {
+            glGetProgramInfoLog(m_shaderProgramID, sizeof(errorLog), nullptr, errorLog);
+            util::fatal_error("Error linking shader program: '%s'\n", errorLog);
+        }
+        if (cacheSupported) {
+            ProgramBinaryCache::Store(m_shaderProgramID, cacheName, cacheKey);
+        }
+        programCacheStats.compiled++;
     }
 
     glValidateProgram(m_shaderProgramID);
@@ -31,10 +66,9 @@ void ShaderHandler::LoadShaders(std::string vertexShaderFile, std::string fragme
     }
 }
 
-GLuint ShaderHandler::CompileShader(GLenum shaderType, std::string filePath)
+GLuint ShaderHandler::CompileShader(GLenum shaderType, const std::string& contents, const std::string& filePath)
 {
-    //read shader file given filePath and compile shader code
-	std::string contents = util::read_file(filePath);
+    //compile the shader code read from filePath
 	const char* source = contents.c_str();
 	int length = strlen(source);
 	GLuint shaderObject = glCreateShader(shaderType);
@@ -53,47 +87,95 @@ GLuint ShaderHandler::CompileShader(GLenum shaderType, std::string filePath)
     return shaderObject;
 }
 
+ProgramCacheStats ShaderHandler::GetProgramCacheStats() {
+    return programCacheStats;
+}
+
 //get the location of a uniform variable in this shader.
-const GLuint ShaderHandler::GetUniformLocation(std::string name) const {
-	return glGetUniformLocation(m_shaderProgramID, name.c_str());
+const GLuint ShaderHandler::GetUniformLocation(const char* name) const {
+	return glGetUniformLocation(m_shaderProgramID, name);
 }
 
-void ShaderHandler::LoadUniformFloat(GLuint location, float value) {
-	glUniform1f(location, value);
+void ShaderHandler::BindUniformBlock(const char* name, GLuint binding) {
+	GLuint blockIndex = glGetUniformBlockIndex(m_shaderProgramID, name);
+	if (blockIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(m_shaderProgramID, blockIndex, binding);
+	}
 }
 
-void ShaderHandler::SetUniformInt(GLuint location, int value) {
-	glUniform1i(location, value);
+//uniforms the program doesn't use have location -1, GL ignores them so they are never sent
+bool ShaderHandler::UniformChanged(GLuint location, const void* values, size_t size) {
+	if (location == GLuint(-1)) {
+		return false;
+	}
+	if (location >= m_uniformCache.size()) {
+		m_uniformCache.resize(size_t(location) + 1);
+	}
+	CachedUniform& cached = m_uniformCache[location];
+	bool changed = !cached.set || std::memcmp(cached.values, values, size) != 0;
+	if (changed) {
+		std::memcpy(cached.values, values, size);
+		cached.set = true;
+	}
+	CountUniformUpload(changed);
+	return changed;
 }
 
-void ShaderHandler::LoadUniformVec2(GLuint location, glm::vec2& value) {
-	glUniform2f(location, value.x, value.y);
+void ShaderHandler::CountUniformUpload(bool uploaded) {
+	if (uploaded) {
+		uniformStats.uploads++;
+	}
+	else {
+		uniformStats.skipped++;
+	}
+}
+
+UniformStats ShaderHandler::TakeUniformStats() {
+	UniformStats stats = uniformStats;
+	uniformStats = UniformStats();
+	return stats;
+}
+
+void ShaderHandler::LoadUniformFloat(GLuint location, float value) {
+	if (UniformChanged(location, &value, sizeof(value))) {
+		glUniform1f(location, value);
+	}
+}
+
+void ShaderHandler::SetUniformInt(GLuint location, int value) {
+	if (UniformChanged(location, &value, sizeof(value))) {
+		glUniform1i(location, value);
+	}
 }
 
-void ShaderHandler::LoadUniformVec3(GLuint location, glm::vec3& value) {
-	glUniform3f(location, value.x, value.y, value.z);
+void ShaderHandler::LoadUniformVec2(GLuint location, const glm::vec2& value) {
+	if (UniformChanged(location, &value, sizeof(value))) {
+		glUniform2f(location, value.x, value.y);
+	}
 }
 
-void ShaderHandler::LoadUniformVec4(GLuint location, glm::vec4& value) {
-	glUniform4f(location, value.x, value.y, value.z, value.w);
+void ShaderHandler::LoadUniformVec3(GLuint location, const glm::vec3& value) {
+	if (UniformChanged(location, &value, sizeof(value))) {
+		glUniform3f(location, value.x, value.y, value.z);
+	}
 }
 
-void ShaderHandler::LoadUniformMatrix4(GLuint location, glm::mat4& value) {
-	glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+void ShaderHandler::LoadUniformVec4(GLuint location, const glm::vec4& value) {
+	if (UniformChanged(location, &value, sizeof(value))) {
+		glUniform4f(location, value.x, value.y, value.z, value.w);
+	}
 }
 
-void ShaderHandler::LoadUniformSampler2D(GLuint location, GLenum texture, GLuint textureID) {
-    glActiveTexture(texture);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glEnable(GL_TEXTURE_2D);
-    glUniform1i(location, texture - GL_TEXTURE0);
+void ShaderHandler::LoadUniformMatrix4(GLuint location, const glm::mat4& value) {
+	if (UniformChanged(location, &value, sizeof(value))) {
+		glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+	}
 }
 
-void ShaderHandler::LoadUniformSamplerCube(GLuint location, GLenum texture, GLuint cubemapTextureID) {
-    glActiveTexture(texture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTextureID);
-    glEnable(GL_TEXTURE_CUBE_MAP);
-    glUniform1i(location, texture - GL_TEXTURE0);
+//samplers keep reading from the same unit for the life of the program, drawing only binds the textures to the units
+void ShaderHandler::SetSamplerUnit(GLuint location, int unit) {
+	Enable();
+	SetUniformInt(location, unit);
 }
 
 //bind an attribute to a shader variable.
@@ -102,19 +184,22 @@ void ShaderHandler::BindAttribute(int attribute, std::string variableName) {
 }
 
 void ShaderHandler::Enable() {
-	glUseProgram(m_shaderProgramID);
+	GLState::Get().UseProgram(m_shaderProgramID);
 }
 
+//the program stays bound until another one is enabled, unbinding it in between would only cost a call
 void ShaderHandler::Disable() {
-	glUseProgram(0);
 }
 
-//delete all shaders
+//delete all shaders. programs loaded from a binary never had any
 void ShaderHandler::Destroy() {
-	Disable();
-	glDetachShader(m_shaderProgramID, m_vertexShaderID);
-	glDetachShader(m_shaderProgramID, m_fragmentShaderID);
-	glDeleteShader(m_vertexShaderID);
-	glDeleteShader(m_fragmentShaderID);
+	GLState::Get().UseProgram(0);
+	if (m_vertexShaderID != 0) {
+		glDetachShader(m_shaderProgramID, m_vertexShaderID);
+		glDetachShader(m_shaderProgramID, m_fragmentShaderID);
+		glDeleteShader(m_vertexShaderID);
+		glDeleteShader(m_fragmentShaderID);
+	}
 	glDeleteProgram(m_shaderProgramID);
+	m_uniformCache.clear();
 }
\ No newline at end of file
@@ -1,33 +1,62 @@
 #pragma once
 #include <glad/glad.h>
 #include <iostream>
+#include <vector>
 #include <glm/glm.hpp>
 
+// glUniform calls made since the stats were last taken, and the ones skipped because the program already held the values
+struct UniformStats {
+	int uploads = 0;
+	int skipped = 0;
+};
 
+// Programs loaded since launch, from the binary cache or compiled from source
+struct ProgramCacheStats {
+	int loaded = 0;
+	int compiled = 0;
+};
+
+// A program and its uniforms. Every uniform keeps a shadow copy of the value the program holds, so setting a value
+// that didn't change costs no GL call. Programs keep their uniforms across glUseProgram, so the copies stay valid as
+// long as only the handler sets them
 class ShaderHandler {
 public:
+	// links the program from the binary cache when it holds one for these sources, compiles it otherwise
 	void LoadShaders(std::string vertexShaderFile, std::string fragmentShaderFile);
 	void Enable();
 	void Disable();
 	void Destroy();
 
-	const GLuint GetUniformLocation(std::string name) const;
+	const GLuint GetUniformLocation(const char* name) const;
+	// points a uniform block of the program at a binding point, blocks the program doesn't use are ignored
+	void BindUniformBlock(const char* name, GLuint binding);
 	void SetUniformInt(GLuint location, int value);
 	void LoadUniformFloat(GLuint location, float value);
-	void LoadUniformVec2(GLuint location, glm::vec2& value);
-	void LoadUniformVec3(GLuint location, glm::vec3& value);
-	void LoadUniformVec4(GLuint location, glm::vec4& value);
-	void LoadUniformMatrix4(GLuint location, glm::mat4& value);
-	void LoadUniformSampler2D(GLuint location, GLenum texture, GLuint textureID);
-	void LoadUniformSamplerCube(GLuint location, GLenum texture, GLuint cubemapTextureID);
+	void LoadUniformVec2(GLuint location, const glm::vec2& value);
+	void LoadUniformVec3(GLuint location, const glm::vec3& value);
+	void LoadUniformVec4(GLuint location, const glm::vec4& value);
+	void LoadUniformMatrix4(GLuint location, const glm::mat4& value);
+	// points a sampler at a texture unit, once after linking. enables the program
+	void SetSamplerUnit(GLuint location, int unit);
 	void BindAttribute(int attribute, std::string variableName);
 
+	static void CountUniformUpload(bool uploaded);
+	// the counts of every program since the last call
+	static UniformStats TakeUniformStats();
+	static ProgramCacheStats GetProgramCacheStats();
 
 private:
-	GLuint m_shaderProgramID;
-	GLuint m_vertexShaderID;
-	GLuint m_fragmentShaderID;
+	struct CachedUniform {
+		bool set = false;
+		float values[16];
+	};
+
+	GLuint m_shaderProgramID = 0;
+	GLuint m_vertexShaderID = 0; // 0 if the program was loaded from the binary cache
+	GLuint m_fragmentShaderID = 0;
+	std::vector<CachedUniform> m_uniformCache; // indexed by location
 
-	GLuint CompileShader(GLenum shaderType, std::string filePath);
-	
+	GLuint CompileShader(GLenum shaderType, const std::string& source, const std::string& filePath);
+	// true if the program holds other values at the location, the values are remembered as sent
+	bool UniformChanged(GLuint location, const void* values, size_t size);
 };
\ No newline at end of file
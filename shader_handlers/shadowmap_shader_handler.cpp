@@ -7,9 +7,33 @@ const std::string FRAGMENT_SHADER = "shaders/shadowmap.fs";
 ShadowmapShaderHandler::ShadowmapShaderHandler() {
     LoadShaders(VERTEX_SHADER, FRAGMENT_SHADER);
     uLightProjection = GetUniformLocation("uLightProjection");
+    uHeightmap = GetUniformLocation("uHeightmap");
+    uCameraPosition = GetUniformLocation("uCameraPosition");
+    uNodeOrigin = GetUniformLocation("uNodeOrigin");
+    uNodeScale = GetUniformLocation("uNodeScale");
+    uMorphRange = GetUniformLocation("uMorphRange");
+    uGridQuads = GetUniformLocation("uGridQuads");
+    uTerrainSize = GetUniformLocation("uTerrainSize");
     BindAttribute(0, "iPosition");
+
+    SetSamplerUnit(uHeightmap, HEIGHTMAP_UNIT);
 }
 
 void ShadowmapShaderHandler::SetLightViewProjection(glm::mat4 lightViewProjection) {
     LoadUniformMatrix4(uLightProjection, lightViewProjection);
+}
+
+void ShadowmapShaderHandler::SetCameraPosition(glm::vec3 cameraPosition) {
+    LoadUniformVec3(uCameraPosition, cameraPosition);
+}
+
+void ShadowmapShaderHandler::SetTerrainDimensions(float gridQuads, float terrainSize) {
+    LoadUniformFloat(uGridQuads, gridQuads);
+    LoadUniformFloat(uTerrainSize, terrainSize);
+}
+
+void ShadowmapShaderHandler::SetNodePlacement(glm::vec2 nodeOrigin, float nodeScale, glm::vec2 morphRange) {
+    LoadUniformVec2(uNodeOrigin, nodeOrigin);
+    LoadUniformFloat(uNodeScale, nodeScale);
+    LoadUniformVec2(uMorphRange, morphRange);
 }
\ No newline at end of file
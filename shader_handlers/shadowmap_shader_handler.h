@@ -6,10 +6,22 @@
 
 class ShadowmapShaderHandler : public ShaderHandler{
 public:
+	static const int HEIGHTMAP_UNIT = 0; // the terrain's, it samples the same texture
+
 	ShadowmapShaderHandler();
 
 	GLuint uLightProjection;
+	GLuint uHeightmap;
+	GLuint uCameraPosition;
+	GLuint uNodeOrigin;
+	GLuint uNodeScale;
+	GLuint uMorphRange;
+	GLuint uGridQuads;
+	GLuint uTerrainSize;
 
 	void SetLightViewProjection(glm::mat4 lightProjection);
+	void SetCameraPosition(glm::vec3 cameraPosition);
+	void SetTerrainDimensions(float gridQuads, float terrainSize);
+	void SetNodePlacement(glm::vec2 nodeOrigin, float nodeScale, glm::vec2 morphRange);
 
 };
\ No newline at end of file
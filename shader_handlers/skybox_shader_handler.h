@@ -6,18 +6,12 @@
 
 class SkyboxShaderHandler : public ShaderHandler {
 public:
+	static const int CUBEMAP_UNIT = 11;
+
 	SkyboxShaderHandler();
 
 	GLuint uViewProjection;
 	GLuint uCubemap;
-	GLuint uLightDirection;
-	GLuint uSunFalloff;
-	GLuint uSunIntensity;
-	GLuint uSunColor;
 
 	void SetViewProjection(glm::mat4 viewProjection);
-	void SetLightDirection(glm::vec3 lightDirection);
-	void SetSunFalloff(float sunFalloff);
-	void SetSunIntensity(float sunIntensity);
-	void SetSunColor(glm::vec3 sunColor);
 };
\ No newline at end of file
@@ -1,14 +1,15 @@
 #include "../util/util.h"
 #include "terrain_shader_handler.h"
+#include "uniform_buffer.h"
 
 const std::string VERTEX_SHADER = "shaders/terrain.vs";
 const std::string FRAGMENT_SHADER = "shaders/terrain.fs";
 
 TerrainShaderHandler::TerrainShaderHandler() {
     LoadShaders(VERTEX_SHADER, FRAGMENT_SHADER);
+    BindUniformBlock("Frame", FRAME_UNIFORM_BINDING);
+    BindUniformBlock("Light", LIGHT_UNIFORM_BINDING);
     uClip = GetUniformLocation("uClip");
-    uLightDirection = GetUniformLocation("uLightDirection");
-    uViewProjection = GetUniformLocation("uViewProjection");
     uMinHeight = GetUniformLocation("uMinHeight");
     uMaxHeight = GetUniformLocation("uMaxHeight");
     uIndicatorPosition = GetUniformLocation("uIndicatorPosition");
@@ -19,30 +20,29 @@ TerrainShaderHandler::TerrainShaderHandler() {
     uPeaksTexture = GetUniformLocation("uPeaksTexture");
     uHeightmap = GetUniformLocation("uHeightmap");
     uShadowmap = GetUniformLocation("uShadowmap");
-    uSunFalloff = GetUniformLocation("uSunFalloff");
-    uSunIntensity = GetUniformLocation("uSunIntensity");
-    uSunColor = GetUniformLocation("uSunColor");
     uLightViewProjection = GetUniformLocation("uLightViewProjection");
-    uCameraPosition = GetUniformLocation("uCameraPosition");
-    uBrightness = GetUniformLocation("uBrightness");
     uTextureScale = GetUniformLocation("uTextureScale");
+    uNodeOrigin = GetUniformLocation("uNodeOrigin");
+    uNodeScale = GetUniformLocation("uNodeScale");
+    uMorphRange = GetUniformLocation("uMorphRange");
+    uGridQuads = GetUniformLocation("uGridQuads");
+    uTerrainSize = GetUniformLocation("uTerrainSize");
 
     BindAttribute(0, "iPosition");
     BindAttribute(1, "iTextureCoords");
+
+    SetSamplerUnit(uHeightmap, HEIGHTMAP_UNIT);
+    SetSamplerUnit(uBaseTexture, BASE_TEXTURE_UNIT);
+    SetSamplerUnit(uGroundTexture, GROUND_TEXTURE_UNIT);
+    SetSamplerUnit(uRockTexture, ROCK_TEXTURE_UNIT);
+    SetSamplerUnit(uPeaksTexture, PEAKS_TEXTURE_UNIT);
+    SetSamplerUnit(uShadowmap, SHADOWMAP_UNIT);
 }
 
 void TerrainShaderHandler::SetClip(glm::vec4 clip) {
     LoadUniformVec4(uClip, clip);
 }
 
-void TerrainShaderHandler::SetLightDirection(glm::vec3 lightDirection) {
-    LoadUniformVec3(uLightDirection, lightDirection);
-}
-
-void TerrainShaderHandler::SetViewProjection(glm::mat4 viewProjection) {
-    LoadUniformMatrix4(uViewProjection, viewProjection);
-}
-
 void TerrainShaderHandler::SetMinHeight(float minHeight) {
     LoadUniformFloat(uMinHeight, minHeight);
 }
@@ -62,26 +62,17 @@ void TerrainShaderHandler::SetLightViewProjection(glm::mat4 lightViewProjection)
     LoadUniformMatrix4(uLightViewProjection, lightViewProjection);
 }
 
-void TerrainShaderHandler::SetBrightness(float brightness) {
-    LoadUniformFloat(uBrightness, brightness);
-}
-
 void TerrainShaderHandler::SetTextureScale(float textureScale){
     LoadUniformFloat(uTextureScale, textureScale);
 }
 
-void TerrainShaderHandler::SetSunFalloff(float sunFalloff){
-    LoadUniformFloat(uSunFalloff, sunFalloff);
-}
-
-void TerrainShaderHandler::SetSunIntensity(float sunIntensity){
-    LoadUniformFloat(uSunIntensity, sunIntensity);
-}
-
-void TerrainShaderHandler::SetCameraPosition(glm::vec3 cameraPosition){
-    LoadUniformVec3(uCameraPosition, cameraPosition);
+void TerrainShaderHandler::SetTerrainDimensions(float gridQuads, float terrainSize){
+    LoadUniformFloat(uGridQuads, gridQuads);
+    LoadUniformFloat(uTerrainSize, terrainSize);
 }
 
-void TerrainShaderHandler::SetSunColor(glm::vec3 sunColor){
-    LoadUniformVec3(uSunColor, sunColor);
+void TerrainShaderHandler::SetNodePlacement(glm::vec2 nodeOrigin, float nodeScale, glm::vec2 morphRange){
+    LoadUniformVec2(uNodeOrigin, nodeOrigin);
+    LoadUniformFloat(uNodeScale, nodeScale);
+    LoadUniformVec2(uMorphRange, morphRange);
 }
\ No newline at end of file
@@ -6,11 +6,19 @@
 
 class TerrainShaderHandler: public ShaderHandler {
 public:
+	// texture units the samplers read from. the units of all programs are distinct, so their textures stay bound from
+	// one frame to the next. a framebuffer's texture may stay bound while it is drawn to, as long as the program
+	// drawing doesn't sample that unit
+	static const int HEIGHTMAP_UNIT = 0;
+	static const int BASE_TEXTURE_UNIT = 1;
+	static const int GROUND_TEXTURE_UNIT = 2;
+	static const int ROCK_TEXTURE_UNIT = 3;
+	static const int PEAKS_TEXTURE_UNIT = 4;
+	static const int SHADOWMAP_UNIT = 5;
+
 	TerrainShaderHandler();
 
-	GLuint uViewProjection;
 	GLuint uClip;
-	GLuint uLightDirection;
 	GLuint uHeightmap;
 	GLuint uMinHeight;
 	GLuint uMaxHeight;
@@ -22,25 +30,20 @@ public:
 	GLuint uPeaksTexture;
 	GLuint uShadowmap;
 	GLuint uLightViewProjection;
-	GLuint uCameraPosition;
-	GLuint uSunFalloff;
-	GLuint uSunIntensity;
-	GLuint uSunColor;
-	GLuint uBrightness;
 	GLuint uTextureScale;
+	GLuint uNodeOrigin;
+	GLuint uNodeScale;
+	GLuint uMorphRange;
+	GLuint uGridQuads;
+	GLuint uTerrainSize;
 
 	void SetClip(glm::vec4 clip);
-	void SetLightDirection(glm::vec3 lightDirection);
-	void SetViewProjection(glm::mat4 viewProjection);
 	void SetMinHeight(float minHeight);
 	void SetMaxHeight(float maxHeight);
 	void SetIndicatorPosition(glm::vec2 indicatorPosition);
 	void SetIndicatorRadius(float indicatorRadius);
 	void SetLightViewProjection(glm::mat4 lightViewProjection);
-	void SetCameraPosition(glm::vec3 cameraPosition);
-	void SetBrightness(float brightness);
 	void SetTextureScale(float textureScale);
-	void SetSunFalloff(float sunFalloff);
-	void SetSunIntensity(float sunIntensity);
-	void SetSunColor(glm::vec3 sunColor);
+	void SetTerrainDimensions(float gridQuads, float terrainSize);
+	void SetNodePlacement(glm::vec2 nodeOrigin, float nodeScale, glm::vec2 morphRange);
 };
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include <cstring>
+#include "uniform_buffer.h"
+#include "shader_handler.h"
+
+UniformBuffer::UniformBuffer(GLuint binding, GLsizeiptr size) : m_binding(binding), m_size(size) {
+    glGenBuffers(1, &m_bufferID);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_bufferID);
+}
+
+//the binding point is set every update, so nothing else that binds uniform buffers can leave it pointing elsewhere
+void UniformBuffer::Update(const void* data) {
+    glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_bufferID);
+    if (!m_contents.empty() && std::memcmp(m_contents.data(), data, m_size) == 0) {
+        ShaderHandler::CountUniformUpload(false);
+        return;
+    }
+    m_contents.assign(static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + m_size);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, m_size, data);
+    ShaderHandler::CountUniformUpload(true);
+}
+
+void UniformBuffer::Destroy() {
+    glDeleteBuffers(1, &m_bufferID);
+    m_bufferID = 0;
+    m_contents.clear();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+// binding points of the uniform blocks the programs share
+const GLuint FRAME_UNIFORM_BINDING = 0;
+const GLuint LIGHT_UNIFORM_BINDING = 1;
+
+// the Frame block, std140. the camera of the main view, used by the terrain and water passes
+struct FrameUniforms {
+	glm::mat4 viewProjection;
+	glm::vec3 cameraPosition;
+	float padding = 0.f;
+};
+
+// the Light block, std140. the sun as seen by the terrain, water and skybox
+struct LightUniforms {
+	glm::vec3 lightDirection;
+	float brightness;
+	glm::vec3 sunColor;
+	float sunFalloff;
+	float sunIntensity;
+	float padding[3] = {};
+};
+
+// A uniform buffer object bound to a fixed binding point. Every program that declares the block reads it, so values
+// shared by several programs are sent once instead of once per program
+class UniformBuffer {
+public:
+	UniformBuffer() = default;
+	UniformBuffer(GLuint binding, GLsizeiptr size);
+
+	// binds the buffer to its binding point and sends the data, unless it is the same as last time
+	void Update(const void* data);
+	template<typename Block>
+	void Update(const Block& block) { Update(static_cast<const void*>(&block)); }
+
+	void Destroy();
+
+private:
+	GLuint m_bufferID = 0;
+	GLuint m_binding = 0;
+	GLsizeiptr m_size = 0;
+	std::vector<unsigned char> m_contents; // what the buffer holds, to skip updates that change nothing
+};
@@ -6,34 +6,27 @@
 
 class WaterShaderHandler : public ShaderHandler {
 public:
+	// texture units the samplers read from, after the terrain's
+	static const int REFLECTION_UNIT = 6;
+	static const int REFRACTION_UNIT = 7;
+	static const int DUDVMAP_UNIT = 8;
+	static const int NORMALMAP_UNIT = 9;
+	static const int DEPTHMAP_UNIT = 10;
+
 	WaterShaderHandler();
 
-	GLuint uViewProjection;
 	GLuint uReflectionTexture;
 	GLuint uRefractionTexture;
 	GLuint uDudvmap;
 	GLuint uNormalmap;
 	GLuint uDepthmap;
 	GLuint uMoveFactor;
-	GLuint uCameraPosition;
-	GLuint uLightDirection;
-	GLuint uBrightness;
-	GLuint uSunIntensity;
-	GLuint uSunFalloff;
-	GLuint uSunColor;
 	GLuint uWaterHeight;
 	GLuint uWaterShininess;
 	
 
-	void SetViewProjection(glm::mat4 viewProjection);
 	void SetMoveFactor(float moveFactor);
-	void SetCameraPosition(glm::vec3 cameraPosition);
-	void SetLightDirection(glm::vec3 lightDireciton);
-	void SetBrightness(float brightness);
-	void SetSunFalloff(float sunFalloff);
-	void SetSunIntensity(float sunIntensity);
 	void SetWaterHeight(float waterHeight);
 	void SetWaterShininess(float waterShininess);
-	void SetSunColor(glm::vec3 sunColor);
 
 };
\ No newline at end of file
@@ -1,10 +1,33 @@
 #version 330 core
 
-in vec3 iPosition;
+layout(location = 0) in vec3 iPosition; // vertex of the terrain patch mesh, in patch quads
  
 uniform mat4 uLightProjection;
+uniform sampler2D uHeightmap;
+uniform vec3 uCameraPosition;
+
+// Placement of the patch being drawn, same as in terrain.vs
+uniform vec2 uNodeOrigin;
+uniform float uNodeScale;
+uniform vec2 uMorphRange;
+uniform float uGridQuads;
+uniform float uTerrainSize;
+
+vec2 PatchToTextureCoords(vec2 patchPosition) {
+	vec2 gridPosition = min(uNodeOrigin + patchPosition * uNodeScale, vec2(uGridQuads));
+	return gridPosition / uGridQuads;
+}
+
+vec3 TextureCoordsToWorld(vec2 uv) {
+	vec2 horizontal = uv * uTerrainSize * 2.0 - uTerrainSize;
+	return vec3(horizontal.x, texture(uHeightmap, uv).r, horizontal.y);
+}
 
 void main(){
-    vec4 worldPosition = vec4(iPosition, 1.0f);
+    vec3 unmorphedPosition = TextureCoordsToWorld(PatchToTextureCoords(iPosition.xz));
+    float morph = clamp((distance(uCameraPosition, unmorphedPosition) - uMorphRange.x) / (uMorphRange.y - uMorphRange.x), 0.0, 1.0);
+    vec2 morphedPosition = iPosition.xz - fract(iPosition.xz * 0.5) * 2.0 * morph;
+
+    vec4 worldPosition = vec4(TextureCoordsToWorld(PatchToTextureCoords(morphedPosition)), 1.0f);
     gl_Position = uLightProjection * worldPosition;
-}
\ No newline at end of file
+}
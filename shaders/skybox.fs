@@ -5,11 +5,15 @@ in vec3 vPosition;
 out vec4 oFragColor;
 
 uniform samplerCube uCubemap;
-uniform vec3 uLightDirection;
 
-uniform float uSunFalloff;   
-uniform float uSunIntensity;
-uniform vec3 uSunColor;
+// Shared by the programs and filled once per frame, see shader_handlers/uniform_buffer.h
+layout(std140) uniform Light {
+	vec3 uLightDirection;
+	float uBrightness;
+	vec3 uSunColor;
+	float uSunFalloff;
+	float uSunIntensity;
+};
 
 void main() {
     float diffuse = max(dot(normalize(vPosition), normalize(uLightDirection)), 0.0f); //diffuse calculations
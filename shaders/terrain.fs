@@ -6,10 +6,7 @@ in vec2 vTextureCoords;    // Texture coordinates
 in vec3 vColor;      // Color passed from the vertex shader (grayscale from heightmap)
 in vec3 vNormal;	// Calculated surface normal from the vertex shader
 
-uniform vec3 uLightDirection; // Light direction. changes according to user input
-uniform float uBrightness;
 uniform mat4 uLightViewProjection;
-uniform vec3 uCameraPosition;
 
 uniform float uMinHeight;
 uniform float uMaxHeight;
@@ -17,10 +14,6 @@ uniform float uMaxHeight;
 uniform vec2 uIndicatorPosition;
 uniform float uIndicatorRadius;
 
-uniform vec3 uSunColor;
-uniform float uSunFalloff;   
-uniform float uSunIntensity;
-
 uniform float uTextureScale;
 uniform sampler2D uBaseTexture;
 uniform sampler2D uGroundTexture;
@@ -28,6 +21,15 @@ uniform sampler2D uRockTexture;
 uniform sampler2D uPeaksTexture;
 uniform sampler2D uShadowmap;
 
+// Shared by the programs and filled once per frame, see shader_handlers/uniform_buffer.h
+layout(std140) uniform Light {
+	vec3 uLightDirection;
+	float uBrightness;
+	vec3 uSunColor;
+	float uSunFalloff;
+	float uSunIntensity;
+};
+
 
 
 // Output to the framebuffer
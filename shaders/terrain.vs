@@ -1,7 +1,7 @@
 #version 330 core
 
-in vec3 iPosition;
-in vec2 iTextureCoords;
+layout(location = 0) in vec3 iPosition; // vertex of the patch mesh, in patch quads
+layout(location = 1) in vec2 iTextureCoords;
 
 out vec3 vPosition;
 out vec2 vTextureCoords;
@@ -10,12 +10,24 @@ out vec3 vNormal;
 out vec4 vFragPositionLight;
 
 uniform vec4 uClip;
-uniform mat4 uViewProjection;
 uniform float uTextureScale;
 uniform float uMinHeight;
 uniform float uMaxHeight;
 uniform sampler2D uHeightmap;
 
+// Shared by the programs and filled once per frame, see shader_handlers/uniform_buffer.h
+layout(std140) uniform Frame {
+	mat4 uViewProjection;
+	vec3 uCameraPosition;
+};
+
+// Placement of the patch being drawn
+uniform vec2 uNodeOrigin; // grid quads
+uniform float uNodeScale; // grid quads per patch quad
+uniform vec2 uMorphRange; // distances over which the patch morphs into the next coarser level
+uniform float uGridQuads; // grid quads per side of the whole terrain
+uniform float uTerrainSize;
+
 // Calculate the surface normal of the heightmap texture. To be used for lighting
 vec3 CalculateSurfaceNormal(vec2 uv) {
     vec2 epsilon = vec2(1.0 / textureSize(uHeightmap, 0).x, 1.0 / textureSize(uHeightmap, 0).y); // Small offset to be used to sample neighbors
@@ -27,11 +39,29 @@ vec3 CalculateSurfaceNormal(vec2 uv) {
     return surfaceNormal;
 }
 
+// Heightmap coordinates of a patch vertex. Vertices past the edge of the map collapse onto it
+vec2 PatchToTextureCoords(vec2 patchPosition) {
+	vec2 gridPosition = min(uNodeOrigin + patchPosition * uNodeScale, vec2(uGridQuads));
+	return gridPosition / uGridQuads;
+}
+
+vec3 TextureCoordsToWorld(vec2 uv) {
+	vec2 horizontal = uv * uTerrainSize * 2.0 - uTerrainSize;
+	return vec3(horizontal.x, texture(uHeightmap, uv).r, horizontal.y);
+}
+
 void main() {
-	vec4 worldPosition = vec4(iPosition + vec3(0.f, texture(uHeightmap, iTextureCoords).r, 0.f), 1.f);
+	// Odd vertices slide onto their even neighbors as the camera moves away, so at the end of the morph range
+	// the patch matches the coarser level next to it
+	vec3 unmorphedPosition = TextureCoordsToWorld(PatchToTextureCoords(iPosition.xz));
+	float morph = clamp((distance(uCameraPosition, unmorphedPosition) - uMorphRange.x) / (uMorphRange.y - uMorphRange.x), 0.0, 1.0);
+	vec2 morphedPosition = iPosition.xz - fract(iPosition.xz * 0.5) * 2.0 * morph;
+	vec2 textureCoords = PatchToTextureCoords(morphedPosition);
+
+	vec4 worldPosition = vec4(TextureCoordsToWorld(textureCoords), 1.f);
 	gl_Position =  uViewProjection * worldPosition;
 	gl_ClipDistance[0] = dot(worldPosition, uClip);
 	vPosition = worldPosition.xyz;
-	vTextureCoords = iTextureCoords * uTextureScale;
-	vNormal = CalculateSurfaceNormal(iTextureCoords);
-}
\ No newline at end of file
+	vTextureCoords = textureCoords * uTextureScale;
+	vNormal = CalculateSurfaceNormal(textureCoords);
+}
@@ -9,19 +9,23 @@ in vec3 vVertexToCamera;
 out vec4 oFragColor;
 
 uniform float uMoveFactor;   
-uniform float uBrightness;
-uniform float uSunFalloff;
-uniform float uSunIntensity;
-uniform vec3 uLightDirection;  
 uniform float uWaterShininess;
 uniform float uWaterHeight;
-uniform vec3 uSunColor;
 uniform sampler2D uReflectionTexture; 
 uniform sampler2D uRefractionTexture; 
 uniform sampler2D uDudvmap;          
 uniform sampler2D uNormalmap;         
 uniform sampler2D uDepthmap;         
 
+// Shared by the programs and filled once per frame, see shader_handlers/uniform_buffer.h
+layout(std140) uniform Light {
+	vec3 uLightDirection;
+	float uBrightness;
+	vec3 uSunColor;
+	float uSunFalloff;
+	float uSunIntensity;
+};
+
 const float reflectivity = 0.5f;    
 const vec4 waterColor = vec4(0.229f, 0.808f, 0.922f, 1.f);
 const vec4 murkinessColor = vec4(0.02f, 0.05f, 0.2f, 1.f); // Slightly less murky
@@ -10,9 +10,12 @@ out vec4 vClipSpace;
 out vec3 vVertexToCamera;
 
 uniform float uWaterHeight;
-uniform mat4 uViewProjection;
-uniform vec3 uCameraPosition;
-uniform vec3 uLightDirection;
+
+// Shared by the programs and filled once per frame, see shader_handlers/uniform_buffer.h
+layout(std140) uniform Frame {
+	mat4 uViewProjection;
+	vec3 uCameraPosition;
+};
 
 
 void main(void) {
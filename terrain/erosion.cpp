@@ -0,0 +1,316 @@
+#include <cmath>
+#include <utility>
+#include "erosion.h"
+#include "../util/thread_pool.h"
+
+//integer hash, so droplet starts don't depend on the standard library's random engines
+static uint32_t Hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+//[0, 1)
+static float NextRandom(uint32_t& state) {
+    state = Hash(state + 0x9e3779b9u);
+    return float(state >> 8) * (1.f / 16777216.f);
+}
+
+void ErosionSimulator::Begin(const Heightmap& heightmap, const ErosionSettings& settings) {
+    m_heights = heightmap.GetHeightField();
+    int resolution = m_heights.GetResolution();
+    m_scratch = HeightField(resolution);
+    m_outflowScale = HeightField(resolution);
+    m_texelSpacing = heightmap.GetSize() * 2.f / resolution;
+    m_iteration = 0;
+    SetSettings(settings);
+}
+
+void ErosionSimulator::SetSettings(const ErosionSettings& settings) {
+    m_settings = settings;
+    BuildBrush();
+}
+
+//weights fall off linearly from the centre and add up to 1
+void ErosionSimulator::BuildBrush() {
+    m_brush.clear();
+    int radius = std::max(m_settings.erosionRadius, 1);
+    float weightSum = 0.f;
+    for (int offsetZ = -radius; offsetZ <= radius; offsetZ++) {
+        for (int offsetX = -radius; offsetX <= radius; offsetX++) {
+            float distance = std::sqrt(float(offsetX * offsetX + offsetZ * offsetZ));
+            if (distance < radius) {
+                float weight = 1.f - distance / radius;
+                m_brush.push_back({ offsetX, offsetZ, weight });
+                weightSum += weight;
+            }
+        }
+    }
+    for (BrushTexel& texel : m_brush) {
+        texel.weight /= weightSum;
+    }
+}
+
+void ErosionSimulator::Step(Heightmap& heightmap, int iterations) {
+    if (!HasBegun()) {
+        return;
+    }
+
+    HeightmapRegion changedRegion;
+    for (int i = 0; i < iterations; i++) {
+        if (m_settings.hydraulic) {
+            ErodeHydraulic(changedRegion);
+        }
+        if (m_settings.thermal) {
+            ErodeThermal();
+            changedRegion.Include(0, 0);
+            changedRegion.Include(m_heights.GetResolution() - 1, m_heights.GetResolution() - 1);
+        }
+        m_iteration++;
+    }
+    heightmap.SetHeights(m_heights, changedRegion);
+}
+
+//the tile grid is shifted every iteration so the tile borders don't stay in one place and show up in the terrain
+void ErosionSimulator::ErodeHydraulic(HeightmapRegion& changedRegion) {
+    int resolution = m_heights.GetResolution();
+    uint32_t iterationSeed = Hash(m_settings.seed ^ Hash(uint32_t(m_iteration)));
+    int offsetX = int(iterationSeed % TILE_SIZE);
+    int offsetZ = int(Hash(iterationSeed) % TILE_SIZE);
+    int tilesX = (resolution + offsetX + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesZ = (resolution + offsetZ + TILE_SIZE - 1) / TILE_SIZE;
+    float dropletsPerTexel = float(m_settings.dropletsPerIteration) / (float(resolution) * resolution);
+
+    //tiles of the same phase are a whole tile apart, and the halo is at most half a tile
+    for (int phase = 0; phase < 4; phase++) {
+        std::vector<int> tiles;
+        for (int tileZ = phase / 2; tileZ < tilesZ; tileZ += 2) {
+            for (int tileX = phase % 2; tileX < tilesX; tileX += 2) {
+                tiles.push_back(tileZ * tilesX + tileX);
+            }
+        }
+        std::vector<HeightmapRegion> tileRegions(tiles.size());
+
+        util::ThreadPool::Get().ParallelFor(0, int(tiles.size()), 1, [&](int tileBegin, int tileEnd) {
+            for (int i = tileBegin; i < tileEnd; i++) {
+                int tileX = tiles[i] % tilesX;
+                int tileZ = tiles[i] / tilesX;
+                int startX = std::max(tileX * TILE_SIZE - offsetX, 0);
+                int startZ = std::max(tileZ * TILE_SIZE - offsetZ, 0);
+                int endX = std::min((tileX + 1) * TILE_SIZE - offsetX, resolution) - 1;
+                int endZ = std::min((tileZ + 1) * TILE_SIZE - offsetZ, resolution) - 1;
+
+                //the fraction of a droplet a tile's area is worth is rounded up or down at random
+                uint32_t tileSeed = Hash(iterationSeed ^ Hash(uint32_t(tiles[i]) + 1u));
+                float expectedDroplets = dropletsPerTexel * (endX - startX + 1) * (endZ - startZ + 1);
+                int dropletCount = int(expectedDroplets);
+                if (NextRandom(tileSeed) < expectedDroplets - dropletCount) {
+                    dropletCount++;
+                }
+                tileRegions[i] = ErodeTile(startX, startZ, endX, endZ, dropletCount, tileSeed);
+            }
+        });
+
+        //only the texels droplets actually wrote go back to the heightmap and its texture
+        for (const HeightmapRegion& tileRegion : tileRegions) {
+            changedRegion.Include(tileRegion);
+        }
+    }
+}
+
+//droplets start in the tile and die when they leave its halo. they only read and write texels inside the halo
+HeightmapRegion ErosionSimulator::ErodeTile(int startX, int startZ, int endX, int endZ, int dropletCount, uint32_t tileSeed) {
+    int resolution = m_heights.GetResolution();
+    int minX = std::max(startX - HALO, 0);
+    int minZ = std::max(startZ - HALO, 0);
+    int maxX = std::min(endX + HALO, resolution - 1);
+    int maxZ = std::min(endZ + HALO, resolution - 1);
+    int brushRadius = std::max(m_settings.erosionRadius, 1);
+    const ErosionSettings& settings = m_settings;
+    HeightmapRegion written;
+
+    //bilinear height and gradient inside the cell a position is in
+    auto SampleHeight = [&](float posX, float posZ, float& gradientX, float& gradientZ) {
+        int nodeX = int(posX);
+        int nodeZ = int(posZ);
+        float cellX = posX - nodeX;
+        float cellZ = posZ - nodeZ;
+        float heightNW = m_heights.Get(nodeX, nodeZ);
+        float heightNE = m_heights.Get(nodeX + 1, nodeZ);
+        float heightSW = m_heights.Get(nodeX, nodeZ + 1);
+        float heightSE = m_heights.Get(nodeX + 1, nodeZ + 1);
+        gradientX = (heightNE - heightNW) * (1.f - cellZ) + (heightSE - heightSW) * cellZ;
+        gradientZ = (heightSW - heightNW) * (1.f - cellX) + (heightSE - heightNE) * cellX;
+        return heightNW * (1.f - cellX) * (1.f - cellZ) + heightNE * cellX * (1.f - cellZ) +
+            heightSW * (1.f - cellX) * cellZ + heightSE * cellX * cellZ;
+    };
+
+    //spreads an amount over the texel and its neighbours to the east and south, by how close the position is to each
+    auto Deposit = [&](int nodeX, int nodeZ, float cellX, float cellZ, float amount) {
+        written.Include(nodeX, nodeZ);
+        written.Include(nodeX + 1, nodeZ + 1);
+        m_heights.Set(nodeX, nodeZ, m_heights.Get(nodeX, nodeZ) + amount * (1.f - cellX) * (1.f - cellZ));
+        m_heights.Set(nodeX + 1, nodeZ, m_heights.Get(nodeX + 1, nodeZ) + amount * cellX * (1.f - cellZ));
+        m_heights.Set(nodeX, nodeZ + 1, m_heights.Get(nodeX, nodeZ + 1) + amount * (1.f - cellX) * cellZ);
+        m_heights.Set(nodeX + 1, nodeZ + 1, m_heights.Get(nodeX + 1, nodeZ + 1) + amount * cellX * cellZ);
+    };
+
+    for (int droplet = 0; droplet < dropletCount; droplet++) {
+        float posX = startX + NextRandom(tileSeed) * (endX - startX + 1);
+        float posZ = startZ + NextRandom(tileSeed) * (endZ - startZ + 1);
+        float dirX = 0.f;
+        float dirZ = 0.f;
+        float speed = 1.f;
+        float water = 1.f;
+        float sediment = 0.f;
+
+        for (int lifetime = 0; lifetime < settings.maxLifetime; lifetime++) {
+            //the texel and its neighbours to the east and south have to be inside the halo
+            if (posX < minX || posX >= maxX || posZ < minZ || posZ >= maxZ) {
+                break;
+            }
+            int nodeX = int(posX);
+            int nodeZ = int(posZ);
+            float cellX = posX - nodeX;
+            float cellZ = posZ - nodeZ;
+
+            float gradientX;
+            float gradientZ;
+            float height = SampleHeight(posX, posZ, gradientX, gradientZ);
+
+            dirX = dirX * settings.inertia - gradientX * (1.f - settings.inertia);
+            dirZ = dirZ * settings.inertia - gradientZ * (1.f - settings.inertia);
+            float length = std::sqrt(dirX * dirX + dirZ * dirZ);
+            if (length == 0.f) {
+                break;
+            }
+            dirX /= length;
+            dirZ /= length;
+            posX += dirX;
+            posZ += dirZ;
+            if (posX < minX || posX >= maxX || posZ < minZ || posZ >= maxZ) {
+                break;
+            }
+
+            float unusedX;
+            float unusedZ;
+            float deltaHeight = SampleHeight(posX, posZ, unusedX, unusedZ) - height;
+            float capacity = std::max(-deltaHeight * speed * water * settings.sedimentCapacity, settings.minSedimentCapacity);
+
+            if (sediment > capacity || deltaHeight > 0.f) {
+                //uphill the droplet fills the pit it came from, otherwise it drops what it can't carry
+                float deposit = deltaHeight > 0.f ? std::min(deltaHeight, sediment) : (sediment - capacity) * settings.depositSpeed;
+                sediment -= deposit;
+                Deposit(nodeX, nodeZ, cellX, cellZ, deposit);
+            }
+            else {
+                //never dig deeper than the height the droplet just came down
+                float erode = std::min((capacity - sediment) * settings.erodeSpeed, -deltaHeight);
+                written.Include(std::max(nodeX - brushRadius, minX), std::max(nodeZ - brushRadius, minZ));
+                written.Include(std::min(nodeX + brushRadius, maxX), std::min(nodeZ + brushRadius, maxZ));
+                for (const BrushTexel& texel : m_brush) {
+                    int x = nodeX + texel.offsetX;
+                    int z = nodeZ + texel.offsetZ;
+                    if (x < minX || x > maxX || z < minZ || z > maxZ) {
+                        continue;
+                    }
+                    float amount = erode * texel.weight;
+                    m_heights.Set(x, z, m_heights.Get(x, z) - amount);
+                    sediment += amount;
+                }
+            }
+
+            speed = std::sqrt(std::max(speed * speed - deltaHeight * settings.gravity, 0.f));
+            water *= 1.f - settings.evaporateSpeed;
+        }
+
+        //a droplet that evaporated or came to rest drops what it still carries, only one leaving the halo loses it
+        if (sediment > 0.f && posX >= minX && posX < maxX && posZ >= minZ && posZ < maxZ) {
+            Deposit(int(posX), int(posZ), posX - int(posX), posZ - int(posZ), sediment);
+        }
+    }
+    return written;
+}
+
+//every texel sheds part of its height above the talus slope to its lower neighbours, in proportion to how far each is
+//below the slope. the first pass removes the outflow and keeps the outflow per unit of excess, the second gathers the
+//inflow from the neighbours, so both passes only write their own rows. neighbours past the edge are clamped to the
+//texel itself, which is never below the slope, so the edges need no checks
+void ErosionSimulator::ErodeThermal() {
+    static const int NEIGHBOUR_COUNT = 8;
+    static const int neighbourX[NEIGHBOUR_COUNT] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+    static const int neighbourZ[NEIGHBOUR_COUNT] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+    int resolution = m_heights.GetResolution();
+    float talus[NEIGHBOUR_COUNT];
+    for (int n = 0; n < NEIGHBOUR_COUNT; n++) {
+        float distance = std::sqrt(float(neighbourX[n] * neighbourX[n] + neighbourZ[n] * neighbourZ[n])) * m_texelSpacing;
+        talus[n] = std::tan(glm::radians(m_settings.talusAngle)) * distance;
+    }
+    float rate = glm::clamp(m_settings.thermalRate, 0.f, 1.f) * 0.5f; // half the excess levels the two texels
+
+    //rows above, at and below z, and the columns left of, at and right of x
+    auto GetNeighbourRows = [&](const HeightField& field, int z, const float* rows[3]) {
+        rows[0] = field.GetRow(std::max(z - 1, 0));
+        rows[1] = field.GetRow(z);
+        rows[2] = field.GetRow(std::min(z + 1, resolution - 1));
+    };
+    auto GetNeighbourColumns = [&](int x, int columns[3]) {
+        columns[0] = std::max(x - 1, 0);
+        columns[1] = x;
+        columns[2] = std::min(x + 1, resolution - 1);
+    };
+
+    util::ThreadPool::Get().ParallelFor(0, resolution, 16, [&](int rowBegin, int rowEnd) {
+        const float* rows[3];
+        int columns[3];
+        for (int z = rowBegin; z < rowEnd; z++) {
+            GetNeighbourRows(m_heights, z, rows);
+            float* scaleRow = m_outflowScale.GetRow(z);
+            float* scratchRow = m_scratch.GetRow(z);
+            for (int x = 0; x < resolution; x++) {
+                GetNeighbourColumns(x, columns);
+                float height = rows[1][x];
+                float excessSum = 0.f;
+                float maxExcess = 0.f;
+                for (int n = 0; n < NEIGHBOUR_COUNT; n++) {
+                    float excess = std::max(height - rows[neighbourZ[n] + 1][columns[neighbourX[n] + 1]] - talus[n], 0.f);
+                    excessSum += excess;
+                    maxExcess = std::max(maxExcess, excess);
+                }
+                float outflow = maxExcess * rate;
+                scaleRow[x] = excessSum > 0.f ? outflow / excessSum : 0.f;
+                scratchRow[x] = height - outflow;
+            }
+        }
+    });
+
+    util::ThreadPool::Get().ParallelFor(0, resolution, 16, [&](int rowBegin, int rowEnd) {
+        const float* rows[3];
+        const float* scaleRows[3];
+        int columns[3];
+        for (int z = rowBegin; z < rowEnd; z++) {
+            GetNeighbourRows(m_heights, z, rows);
+            GetNeighbourRows(m_outflowScale, z, scaleRows);
+            float* scratchRow = m_scratch.GetRow(z);
+            for (int x = 0; x < resolution; x++) {
+                GetNeighbourColumns(x, columns);
+                float height = rows[1][x];
+                float inflow = 0.f;
+                for (int n = 0; n < NEIGHBOUR_COUNT; n++) {
+                    //the talus between a pair of texels is the same both ways
+                    int row = neighbourZ[n] + 1;
+                    int column = columns[neighbourX[n] + 1];
+                    float excess = std::max(rows[row][column] - height - talus[n], 0.f);
+                    inflow += excess * scaleRows[row][column];
+                }
+                scratchRow[x] += inflow;
+            }
+        }
+    });
+
+    std::swap(m_heights, m_scratch);
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "heightmap.h"
+
+struct ErosionSettings {
+	uint32_t seed = 1; // the same seed and heights always erode to the same result, whatever the thread count
+
+	//hydraulic, water droplets that pick up sediment going downhill and drop it where they slow down
+	bool hydraulic = true;
+	int dropletsPerIteration = 4096; // across the whole map
+	int maxLifetime = 30; // steps of about a texel before a droplet evaporates
+	int erosionRadius = 3; // texels a droplet erodes around it
+	float inertia = 0.05f; // how much a droplet keeps its direction instead of following the slope
+	float sedimentCapacity = 4.f;
+	float minSedimentCapacity = 0.01f;
+	float erodeSpeed = 0.3f;
+	float depositSpeed = 0.3f;
+	float evaporateSpeed = 0.01f;
+	float gravity = 4.f;
+
+	//thermal, material sliding down slopes steeper than the talus angle
+	bool thermal = true;
+	float talusAngle = 35.f; // degrees
+	float thermalRate = 0.5f; // share of the excess moved per iteration, [0, 1]
+};
+
+// Hydraulic and thermal erosion of a heightmap, run a few iterations at a time so it can evolve over frames.
+//
+// The simulation works on its own copy of the heights and writes the texels it changed back to the heightmap after
+// every step, the box around the texels droplets wrote or the whole map once thermal erosion ran. Droplets are simulated in tiles spread over the thread pool. A droplet may leave its tile by up to a halo,
+// and the tiles are done in four phases so no two tiles running at once share texels. Every droplet's start comes from
+// the seed, the iteration and its tile, so the result doesn't depend on how the tiles are scheduled. Thermal erosion
+// reads the previous iteration and writes a new one, which is deterministic by construction.
+class ErosionSimulator {
+public:
+	static const int TILE_SIZE = 128;
+	static const int HALO = 32; // at most half a tile, so the tiles of a phase stay apart
+
+	ErosionSimulator() = default;
+
+	//prevent copying
+	ErosionSimulator(const ErosionSimulator&) = delete;
+	ErosionSimulator& operator=(const ErosionSimulator&) = delete;
+
+	// starts from the heightmap's current heights, iteration 0
+	void Begin(const Heightmap& heightmap, const ErosionSettings& settings);
+	// runs iterations and writes the changed texels to the heightmap, which has to be the one Begin copied
+	void Step(Heightmap& heightmap, int iterations);
+
+	bool HasBegun() const { return m_heights.GetResolution() > 0; }
+	int GetIteration() const { return m_iteration; }
+	const ErosionSettings& GetSettings() const { return m_settings; }
+	// takes effect from the next iteration
+	void SetSettings(const ErosionSettings& settings);
+
+private:
+	struct BrushTexel {
+		int offsetX;
+		int offsetZ;
+		float weight;
+	};
+
+	void ErodeHydraulic(HeightmapRegion& changedRegion);
+	// returns the texels the droplets wrote, empty if none did
+	HeightmapRegion ErodeTile(int startX, int startZ, int endX, int endZ, int dropletCount, uint32_t tileSeed);
+	void ErodeThermal();
+	void BuildBrush();
+
+	ErosionSettings m_settings;
+	int m_iteration = 0;
+	float m_texelSpacing = 1.f; // world units between texels
+	HeightField m_heights;
+	HeightField m_scratch; // the thermal iteration being written
+	HeightField m_outflowScale; // thermal outflow per unit of excess height, per texel
+	std::vector<BrushTexel> m_brush;
+};
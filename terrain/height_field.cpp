@@ -0,0 +1,73 @@
+#include <cfloat>
+#include <cstring>
+#include <new>
+#include <vector>
+#include "height_field.h"
+#include "../util/thread_pool.h"
+
+static float* AllocateAligned(size_t texelCount) {
+    return static_cast<float*>(::operator new[](texelCount * sizeof(float), std::align_val_t(HeightField::ALIGNMENT)));
+}
+
+void HeightField::AlignedDelete::operator()(float* data) const {
+    ::operator delete[](data, std::align_val_t(HeightField::ALIGNMENT));
+}
+
+HeightField::HeightField(int resolution) : m_resolution(resolution), m_data(AllocateAligned(GetTexelCount())) {
+    std::memset(m_data.get(), 0, GetTexelCount() * sizeof(float));
+}
+
+HeightField::HeightField(const HeightField& other) : m_resolution(other.m_resolution) {
+    if (other.m_data) {
+        m_data.reset(AllocateAligned(GetTexelCount()));
+        std::memcpy(m_data.get(), other.m_data.get(), GetTexelCount() * sizeof(float));
+    }
+}
+
+HeightField& HeightField::operator=(const HeightField& other) {
+    if (this == &other) {
+        return *this;
+    }
+    //the allocation is reused when the resolution stays the same, which is the common case for double buffering
+    if (m_resolution != other.m_resolution || !m_data) {
+        m_data.reset(other.m_data ? AllocateAligned(other.GetTexelCount()) : nullptr);
+        m_resolution = other.m_resolution;
+    }
+    if (other.m_data) {
+        std::memcpy(m_data.get(), other.m_data.get(), GetTexelCount() * sizeof(float));
+    }
+    return *this;
+}
+
+HeightFieldView<float> HeightField::GetView(const HeightmapRegion& region) {
+    return { GetRow(region.minZ) + region.minX, region.GetWidth(), region.GetHeight(), m_resolution };
+}
+
+HeightFieldView<const float> HeightField::GetView(const HeightmapRegion& region) const {
+    return { GetRow(region.minZ) + region.minX, region.GetWidth(), region.GetHeight(), m_resolution };
+}
+
+void HeightField::GetRange(float& minHeight, float& maxHeight) const {
+    const int rowsPerBand = 64;
+    const int bandCount = (m_resolution + rowsPerBand - 1) / rowsPerBand;
+    std::vector<float> bandMinHeights(bandCount, FLT_MAX);
+    std::vector<float> bandMaxHeights(bandCount, -FLT_MAX);
+
+    util::ThreadPool::Get().ParallelFor(0, m_resolution, rowsPerBand, [&](int rowBegin, int rowEnd) {
+        float bandMin = FLT_MAX;
+        float bandMax = -FLT_MAX;
+        for (const float* height = GetRow(rowBegin); height < GetRow(rowEnd); height++) {
+            bandMin = std::min(bandMin, *height);
+            bandMax = std::max(bandMax, *height);
+        }
+        bandMinHeights[rowBegin / rowsPerBand] = bandMin;
+        bandMaxHeights[rowBegin / rowsPerBand] = bandMax;
+    });
+
+    minHeight = FLT_MAX;
+    maxHeight = -FLT_MAX;
+    for (int band = 0; band < bandCount; band++) {
+        minHeight = std::min(minHeight, bandMinHeights[band]);
+        maxHeight = std::max(maxHeight, bandMaxHeights[band]);
+    }
+}
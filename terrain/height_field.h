@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <memory>
+
+// Inclusive texel bounds of the area of a heightmap that changed.
+struct HeightmapRegion {
+	int minX = INT_MAX;
+	int minZ = INT_MAX;
+	int maxX = INT_MIN;
+	int maxZ = INT_MIN;
+
+	bool IsEmpty() const { return maxX < minX || maxZ < minZ; }
+	int GetWidth() const { return maxX - minX + 1; }
+	int GetHeight() const { return maxZ - minZ + 1; }
+
+	void Include(int x, int z) {
+		minX = std::min(minX, x);
+		minZ = std::min(minZ, z);
+		maxX = std::max(maxX, x);
+		maxZ = std::max(maxZ, z);
+	}
+
+	void Include(const HeightmapRegion& region) {
+		if (!region.IsEmpty()) {
+			Include(region.minX, region.minZ);
+			Include(region.maxX, region.maxZ);
+		}
+	}
+
+	void Reset() { *this = HeightmapRegion(); }
+};
+
+// A rectangle of heights inside a height field. rows are stride floats apart, so a view can be handed to code that
+// works on a tile without copying it out.
+template<typename T>
+struct HeightFieldView {
+	T* data = nullptr;
+	int width = 0;
+	int height = 0;
+	int stride = 0;
+
+	T* GetRow(int z) const { return data + size_t(z) * stride; }
+	T& At(int x, int z) const { return data[size_t(z) * stride + x]; }
+};
+
+// Square grid of heights in one aligned, contiguous allocation, row by row. Plain CPU data with no GL objects, so it
+// can be created, filled and copied on any thread.
+class HeightField {
+public:
+	static const size_t ALIGNMENT = 64; // a cache line, and enough for any SIMD width
+
+	HeightField() = default;
+	explicit HeightField(int resolution);
+
+	HeightField(const HeightField& other);
+	HeightField& operator=(const HeightField& other);
+	HeightField(HeightField&&) noexcept = default;
+	HeightField& operator=(HeightField&&) noexcept = default;
+
+	int GetResolution() const { return m_resolution; }
+	size_t GetTexelCount() const { return size_t(m_resolution) * m_resolution; }
+
+	float* GetData() { return m_data.get(); }
+	const float* GetData() const { return m_data.get(); }
+	float* GetRow(int z) { return m_data.get() + size_t(z) * m_resolution; }
+	const float* GetRow(int z) const { return m_data.get() + size_t(z) * m_resolution; }
+
+	// no bounds checks, x and z have to be inside the grid
+	float Get(int x, int z) const { return m_data[size_t(z) * m_resolution + x]; }
+	void Set(int x, int z, float height) { m_data[size_t(z) * m_resolution + x] = height; }
+
+	// the region has to be inside the grid
+	HeightFieldView<float> GetView(const HeightmapRegion& region);
+	HeightFieldView<const float> GetView(const HeightmapRegion& region) const;
+
+	// lowest and highest height, scanned in row bands on the thread pool
+	void GetRange(float& minHeight, float& maxHeight) const;
+
+private:
+	struct AlignedDelete {
+		void operator()(float* data) const;
+	};
+
+	int m_resolution = 0;
+	std::unique_ptr<float[], AlignedDelete> m_data;
+};
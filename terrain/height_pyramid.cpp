@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "height_pyramid.h"
+#include "../util/thread_pool.h"
+
+HeightPyramid::HeightPyramid(const Heightmap& heightmap) : m_gridQuads(int(heightmap.GetResolution()) - 1) {
+    //add levels until a single cell covers the whole grid
+    m_levels.emplace_back();
+    while ((1 << (GetLevelCount() - 1)) < m_gridQuads) {
+        int cellsPerSide = GetCellsPerSide(GetLevelCount());
+        m_levels.emplace_back(cellsPerSide * cellsPerSide, glm::vec2(0.f));
+    }
+
+    HeightmapRegion wholeMap;
+    wholeMap.Include(0, 0);
+    wholeMap.Include(m_gridQuads, m_gridQuads);
+    Update(heightmap, wholeMap);
+}
+
+//recompute the cells overlapping the changed texels. level 1 scans the heightmap, every level above merges its children
+void HeightPyramid::Update(const Heightmap& heightmap, const HeightmapRegion& region) {
+    if (region.IsEmpty()) {
+        return;
+    }
+
+    //a texel is a corner of the quads on both sides of it
+    int startQuadX = std::max(region.minX - 1, 0);
+    int startQuadZ = std::max(region.minZ - 1, 0);
+    int endQuadX = std::min(region.maxX, m_gridQuads - 1);
+    int endQuadZ = std::min(region.maxZ, m_gridQuads - 1);
+
+    for (int level = 1; level < GetLevelCount(); level++) {
+        int cellsPerSide = GetCellsPerSide(level);
+        int startCellX = startQuadX >> level;
+        int startCellZ = startQuadZ >> level;
+        int endCellX = endQuadX >> level;
+        int endCellZ = endQuadZ >> level;
+        std::vector<glm::vec2>& cells = m_levels[level];
+
+        if (level == 1) {
+            util::ThreadPool::Get().ParallelFor(startCellZ, endCellZ + 1, 16, [&](int rowBegin, int rowEnd) {
+                for (int cellZ = rowBegin; cellZ < rowEnd; cellZ++) {
+                    for (int cellX = startCellX; cellX <= endCellX; cellX++) {
+                        //2x2 quads share 3x3 texels
+                        int endX = std::min(cellX * 2 + 2, m_gridQuads);
+                        int endZ = std::min(cellZ * 2 + 2, m_gridQuads);
+
+                        glm::vec2 range(FLT_MAX, -FLT_MAX);
+                        for (int z = cellZ * 2; z <= endZ; z++) {
+                            for (int x = cellX * 2; x <= endX; x++) {
+                                float height = heightmap.GetHeight(x, z);
+                                range.x = std::min(range.x, height);
+                                range.y = std::max(range.y, height);
+                            }
+                        }
+                        cells[cellZ * cellsPerSide + cellX] = range;
+                    }
+                }
+            });
+            continue;
+        }
+
+        const std::vector<glm::vec2>& childCells = m_levels[level - 1];
+        int childCellsPerSide = GetCellsPerSide(level - 1);
+        for (int cellZ = startCellZ; cellZ <= endCellZ; cellZ++) {
+            for (int cellX = startCellX; cellX <= endCellX; cellX++) {
+                glm::vec2 range(FLT_MAX, -FLT_MAX);
+                for (int quadrant = 0; quadrant < 4; quadrant++) {
+                    int childX = cellX * 2 + (quadrant & 1);
+                    int childZ = cellZ * 2 + (quadrant >> 1);
+                    if (childX >= childCellsPerSide || childZ >= childCellsPerSide) {
+                        continue;
+                    }
+                    const glm::vec2& childRange = childCells[childZ * childCellsPerSide + childX];
+                    range.x = std::min(range.x, childRange.x);
+                    range.y = std::max(range.y, childRange.y);
+                }
+                cells[cellZ * cellsPerSide + cellX] = range;
+            }
+        }
+    }
+}
+
+glm::vec2 HeightPyramid::GetRange(const Heightmap& heightmap, int level, int cellX, int cellZ) const {
+    if (level > 0) {
+        return m_levels[level][cellZ * GetCellsPerSide(level) + cellX];
+    }
+
+    //the bilinear surface of a quad never leaves the range of its corners
+    float h00 = heightmap.GetHeight(cellX, cellZ);
+    float h10 = heightmap.GetHeight(cellX + 1, cellZ);
+    float h01 = heightmap.GetHeight(cellX, cellZ + 1);
+    float h11 = heightmap.GetHeight(cellX + 1, cellZ + 1);
+    return glm::vec2(std::min(std::min(h00, h10), std::min(h01, h11)), std::max(std::max(h00, h10), std::max(h01, h11)));
+}
+
+//index of the cell the ray is in just after position, so a ray sitting on a cell border is placed in the cell it moves into
+static int GetCellIndex(double position, double direction, int cellSize, int cellsPerSide) {
+    const double nudge = 1e-7;
+    double nudged = position + (direction > 0.0 ? nudge : (direction < 0.0 ? -nudge : 0.0));
+    return std::clamp(int(std::floor(nudged / cellSize)), 0, cellsPerSide - 1);
+}
+
+//the ray is traversed in grid space, where a quad is one unit wide and heights are unchanged. this keeps the distance
+//parameter identical to the one in world space
+bool HeightPyramid::Raycast(const Heightmap& heightmap, glm::vec3 origin, glm::vec3 direction, float& hitDistance) const {
+    if (m_levels.empty()) {
+        return false;
+    }
+
+    double size = heightmap.GetSize();
+    double gridScale = m_gridQuads / (2.0 * size);
+    glm::dvec3 gridOrigin((origin.x + size) * gridScale, origin.y, (origin.z + size) * gridScale);
+    glm::dvec3 gridDirection(direction.x * gridScale, direction.y, direction.z * gridScale);
+
+    int topLevel = GetLevelCount() - 1;
+    glm::vec2 heightRange = GetRange(heightmap, topLevel, 0, 0);
+    glm::dvec3 boundsMin(0.0, heightRange.x, 0.0);
+    glm::dvec3 boundsMax(m_gridQuads, heightRange.y, m_gridQuads);
+
+    //clip the ray to the box around the whole terrain
+    double t = 0.0;
+    double tEnd = DBL_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+        if (gridDirection[axis] == 0.0) {
+            if (gridOrigin[axis] < boundsMin[axis] || gridOrigin[axis] > boundsMax[axis]) {
+                return false;
+            }
+            continue;
+        }
+        double tNear = (boundsMin[axis] - gridOrigin[axis]) / gridDirection[axis];
+        double tFar = (boundsMax[axis] - gridOrigin[axis]) / gridDirection[axis];
+        if (tNear > tFar) {
+            std::swap(tNear, tFar);
+        }
+        t = std::max(t, tNear);
+        tEnd = std::min(tEnd, tFar);
+    }
+
+    glm::dvec3 inverseDirection(1.0 / gridDirection.x, 1.0 / gridDirection.y, 1.0 / gridDirection.z);
+
+    //walk the cells the ray passes through, dropping a level whenever the ray may touch the terrain in the current cell
+    //and climbing back up one level after leaving a cell
+    int level = topLevel;
+    while (t <= tEnd) {
+        int cellSize = 1 << level;
+        int cellsPerSide = GetCellsPerSide(level);
+        glm::dvec3 position = gridOrigin + gridDirection * t;
+        int cellX = GetCellIndex(position.x, gridDirection.x, cellSize, cellsPerSide);
+        int cellZ = GetCellIndex(position.z, gridDirection.z, cellSize, cellsPerSide);
+
+        double tCellExit = tEnd;
+        if (gridDirection.x != 0.0) {
+            double borderX = (gridDirection.x > 0.0 ? cellX + 1 : cellX) * double(cellSize);
+            tCellExit = std::min(tCellExit, (borderX - gridOrigin.x) * inverseDirection.x);
+        }
+        if (gridDirection.z != 0.0) {
+            double borderZ = (gridDirection.z > 0.0 ? cellZ + 1 : cellZ) * double(cellSize);
+            tCellExit = std::min(tCellExit, (borderZ - gridOrigin.z) * inverseDirection.z);
+        }
+        //only the cells clamped at the edge of the grid can end behind the ray, which means it has left the terrain
+        if (tCellExit <= t) {
+            break;
+        }
+
+        //the ray is straight, so its lowest point in the cell is at one of the ends
+        double lowestY = std::min(position.y, gridOrigin.y + gridDirection.y * tCellExit);
+        bool passesAbove = lowestY > GetRange(heightmap, level, cellX, cellZ).y;
+
+        if (!passesAbove && level > 0) {
+            level--;
+            continue;
+        }
+
+        if (!passesAbove) {
+            double hitOffset;
+            if (IntersectQuad(heightmap, cellX, cellZ, position, gridDirection, tCellExit - t, hitOffset)) {
+                hitDistance = float(t + hitOffset);
+                return true;
+            }
+        }
+
+        if (tCellExit >= tEnd) {
+            break;
+        }
+        t = tCellExit;
+        level = std::min(level + 1, topLevel);
+    }
+
+    return false;
+}
+
+//first point along [start, start + direction * length] that is at or below the bilinear surface of the quad
+bool HeightPyramid::IntersectQuad(const Heightmap& heightmap, int quadX, int quadZ, const glm::dvec3& start, const glm::dvec3& direction, double length, double& hitOffset) const {
+    double h00 = heightmap.GetHeight(quadX, quadZ);
+    double h10 = heightmap.GetHeight(quadX + 1, quadZ);
+    double h01 = heightmap.GetHeight(quadX, quadZ + 1);
+    double h11 = heightmap.GetHeight(quadX + 1, quadZ + 1);
+
+    //height(u, v) = h00 + b*u + c*v + d*u*v with u, v the position inside the quad
+    double b = h10 - h00;
+    double c = h01 - h00;
+    double d = h00 - h10 - h01 + h11;
+    double u = start.x - quadX;
+    double v = start.z - quadZ;
+
+    //ray height minus surface height along the ray is a quadratic in the offset s: qa*s^2 + qb*s + qc
+    double qa = -d * direction.x * direction.z;
+    double qb = direction.y - b * direction.x - c * direction.z - d * (u * direction.z + v * direction.x);
+    double qc = start.y - (h00 + b * u + c * v + d * u * v);
+
+    if (qc <= 0.0) {
+        hitOffset = 0.0;
+        return true;
+    }
+
+    double firstRoot = DBL_MAX;
+    if (std::abs(qa) < 1e-12) {
+        if (qb < 0.0) {
+            firstRoot = -qc / qb;
+        }
+    }
+    else {
+        double discriminant = qb * qb - 4.0 * qa * qc;
+        if (discriminant < 0.0) {
+            return false;
+        }
+        //numerically stable form of the two roots
+        double q = -0.5 * (qb + std::copysign(std::sqrt(discriminant), qb));
+        double roots[2] = { q / qa, q != 0.0 ? qc / q : DBL_MAX };
+        for (double root : roots) {
+            if (root >= 0.0) {
+                firstRoot = std::min(firstRoot, root);
+            }
+        }
+    }
+
+    if (firstRoot > length) {
+        return false;
+    }
+    hitOffset = firstRoot;
+    return true;
+}
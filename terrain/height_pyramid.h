@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "heightmap.h"
+
+// Min/max heights of the heightmap grid at every power of two cell size, down to single quads.
+// Lets a ray skip whole blocks of terrain it passes above, and find the exact first hit on the bilinear
+// surface between texels once it reaches a single quad.
+class HeightPyramid {
+public:
+	HeightPyramid() = default;
+	explicit HeightPyramid(const Heightmap& heightmap);
+
+	void Update(const Heightmap& heightmap, const HeightmapRegion& region);
+
+	// distance along the normalized direction to the first point at or below the terrain, false if the ray misses
+	bool Raycast(const Heightmap& heightmap, glm::vec3 origin, glm::vec3 direction, float& hitDistance) const;
+
+	int GetLevelCount() const { return int(m_levels.size()); }
+
+private:
+	int GetCellsPerSide(int level) const { return (m_gridQuads + (1 << level) - 1) >> level; }
+	glm::vec2 GetRange(const Heightmap& heightmap, int level, int cellX, int cellZ) const;
+	bool IntersectQuad(const Heightmap& heightmap, int quadX, int quadZ, const glm::dvec3& start, const glm::dvec3& direction, double length, double& hitOffset) const;
+
+	int m_gridQuads = 0;
+	// (min, max) per cell, row major. level 0 holds single quads and is read straight from the heightmap, so it stays empty
+	std::vector<std::vector<glm::vec2>> m_levels;
+};
@@ -1,57 +1,226 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <vector>
+#include <FastNoise/FastNoise.h>
 #include "heightmap.h"
+#include "../util/thread_pool.h"
 
 
-Heightmap::Heightmap(float size, int resolution, float noiseSeed, DataFactory dataFactory) : m_heightmapSize(size), m_heightmapResolution(resolution), m_noiseSeed(noiseSeed) {
-    m_map = std::make_unique<float[]>(m_heightmapResolution * m_heightmapResolution);
+Heightmap::Heightmap(float size, int resolution, float noiseSeed) : m_heightmapSize(size), m_heightmapResolution(resolution), m_noiseSeed(noiseSeed) {
+    m_heights = HeightField(m_heightmapResolution);
+    ResetHeightRange(0.f);
     GenerateHeightsUsingNoise(0, noiseSeed);
+}
+
+//flat heightmap for heights that come from somewhere other than noise
+Heightmap::Heightmap(float size, int resolution) : m_heightmapSize(size), m_heightmapResolution(resolution) {
+    m_heights = HeightField(m_heightmapResolution);
+    m_noiseSeed = float(FastNoise().GetSeed());
+    ResetHeightRange(0.f);
+    MarkAllDirty();
+}
 
-    m_textureID = dataFactory.CreateTexture();
-    glBindTexture(GL_TEXTURE_2D, m_textureID); // make heightmap texture configurable
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // prevent horizontal wrapping outside of [0,1]
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); // same but for vertical
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // linearly interpolate texture values between neighbor textures to look smoother
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // same but for larger sample size
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_heightmapResolution, m_heightmapResolution, 0, GL_RED, GL_FLOAT, m_map.get()); // upload texture data to gpu
-    glBindTexture(GL_TEXTURE_2D, 0);
+void Heightmap::MarkAllDirty() {
+    m_dirtyRegion.Include(0, 0);
+    m_dirtyRegion.Include(m_heightmapResolution - 1, m_heightmapResolution - 1);
 }
 
 //generates height values using noise
-void Heightmap::GenerateHeightsUsingNoise(int noiseType, float noiseSeed) {
-    if (noiseSeed != m_noiseSeed) {
-        m_noise.SetSeed(noiseSeed);
-        m_noiseSeed = noiseSeed;
+bool Heightmap::GenerateHeightsUsingNoise(int noiseType, float noiseSeed, const std::atomic<bool>* cancelled, std::atomic<float>* progress) {
+    HeightmapLayerSettings settings = m_layers.empty() ? HeightmapLayerSettings() : m_layers[0].settings;
+    settings.noiseType = noiseType;
+    settings.noiseSeed = noiseSeed;
+    settings.frequency = Frequency;
+    settings.amplitude = Amplitude;
+
+    if (m_layers.empty()) {
+        m_layers.emplace_back();
     }
+    //generating always samples the noise again, even if the cached noise has the same settings
+    m_layers[0].noise.reset();
+    SetLayerSettings(0, settings);
+    return UpdateLayers(cancelled, progress);
+}
 
-    if (noiseType == 0) {
-        m_noise.SetNoiseType(FastNoise::SimplexFractal);
-        m_noise.SetFractalOctaves(5);
+//a layer's change only reaches as far as its stamp, before and after the change. the base layer covers everything
+void Heightmap::SetLayerSettings(int index, const HeightmapLayerSettings& settings) {
+    HeightmapLayer& layer = m_layers[index];
+    if (index == 0) {
+        m_layersDirtyRegion.Include(LayerCompositor::GetMaskRegion(HeightmapLayerSettings(), m_heightmapSize, m_heightmapResolution));
+        m_noiseSeed = settings.noiseSeed;
+        Amplitude = settings.amplitude;
+        Frequency = settings.frequency;
     }
     else {
-        m_noise.SetNoiseType(FastNoise::Simplex);
-        m_noise.SetFractalOctaves(5);
+        m_layersDirtyRegion.Include(LayerCompositor::GetMaskRegion(layer.settings, m_heightmapSize, m_heightmapResolution));
+        m_layersDirtyRegion.Include(LayerCompositor::GetMaskRegion(settings, m_heightmapSize, m_heightmapResolution));
     }
+    layer.settings = settings;
+}
 
-    m_maxHeight = FLT_MIN;
-    m_minHeight = FLT_MAX;
+bool Heightmap::AddLayer(const HeightmapLayerSettings& settings) {
+    if (m_layers.empty()) {
+        return false;
+    }
+    m_layers.emplace_back();
+    m_layers.back().settings = settings;
+    m_layersDirtyRegion.Include(LayerCompositor::GetMaskRegion(settings, m_heightmapSize, m_heightmapResolution));
+    return true;
+}
+
+void Heightmap::RemoveLayer(int index) {
+    if (index <= 0 || index >= int(m_layers.size())) {
+        return;
+    }
+    m_layersDirtyRegion.Include(LayerCompositor::GetMaskRegion(m_layers[index].settings, m_heightmapSize, m_heightmapResolution));
+    m_layers.erase(m_layers.begin() + index);
+}
 
-    //init heightmap with noise values
-    for (int i = 0; i < m_heightmapResolution; ++i) {
-        for (int j = 0; j < m_heightmapResolution; ++j) {
-            float x = float(i) / float(m_heightmapResolution - 1) * 2.f - 1.f;
-            float y = float(j) / float(m_heightmapResolution - 1) * 2.f - 1.f;
+void Heightmap::SetLayers(const std::vector<HeightmapLayer>& layers) {
+    m_layers = layers;
+    if (!m_layers.empty()) {
+        SetLayerSettings(0, m_layers[0].settings);
+    }
+}
 
-            float height = 0.f;
+bool Heightmap::HasLayerNoise() const {
+    if (m_layers.empty()) {
+        return false;
+    }
+    for (const HeightmapLayer& layer : m_layers) {
+        if (!layer.HasNoise(m_heightmapResolution)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-            if (noiseType == 0) {
-                height = SampleNoise(x * Frequency, y * Frequency) * Amplitude;
-            }
-            else {
-                height = fBm(glm::vec2(x, y)) * Amplitude;
+//noise is generated one layer at a time, each layer is spread over the thread pool. composing only covers the region
+//the changes reach
+bool Heightmap::UpdateLayers(const std::atomic<bool>* cancelled, std::atomic<float>* progress) {
+    if (m_layers.empty()) {
+        return true;
+    }
+
+    for (HeightmapLayer& layer : m_layers) {
+        if (layer.HasNoise(m_heightmapResolution)) {
+            continue;
+        }
+        std::shared_ptr<HeightField> noise = LayerCompositor::GenerateNoise(layer.settings, m_heightmapSize, m_heightmapResolution,
+            layer.noiseMin, layer.noiseMax, cancelled, progress);
+        if (!noise) {
+            return false;
+        }
+        layer.noise = noise;
+        layer.noiseSettings = layer.settings;
+        m_layersDirtyRegion.Include(LayerCompositor::GetMaskRegion(layer.settings, m_heightmapSize, m_heightmapResolution));
+    }
+
+    if (m_layersDirtyRegion.IsEmpty()) {
+        return true;
+    }
+
+    bool wholeMap = m_layersDirtyRegion.minX == 0 && m_layersDirtyRegion.minZ == 0 &&
+        m_layersDirtyRegion.maxX == m_heightmapResolution - 1 && m_layersDirtyRegion.maxZ == m_heightmapResolution - 1;
+    if (!wholeMap || !ComposeBaseLayer()) {
+        LayerCompositor::Composite(m_layers, m_sculptLayer.get(), m_heightmapSize, m_layersDirtyRegion, m_heights);
+        MarkRangeStale(m_layersDirtyRegion);
+        UpdateHeightRange();
+    }
+
+    m_dirtyRegion.Include(m_layersDirtyRegion);
+    m_layersDirtyRegion.Reset();
+    return true;
+}
+
+//with every layer above the base switched off the heights are the base noise times amplitude plus the sculpting, one
+//scaling pass over the map. that is what an amplitude change comes down to. the tile ranges are taken in the same pass,
+//and without sculpting the map's range follows from the range of the noise
+bool Heightmap::ComposeBaseLayer() {
+    for (size_t i = 1; i < m_layers.size(); i++) {
+        if (m_layers[i].settings.enabled && m_layers[i].settings.opacity > 0.f) {
+            return false;
+        }
+    }
+
+    const HeightmapLayer& base = m_layers[0];
+    const float amplitude = base.settings.amplitude;
+    const HeightField* sculpt = m_sculptLayer.get();
+    util::ThreadPool::Get().ParallelFor(0, int(m_tileRanges.size()), 1, [&](int tileBegin, int tileEnd) {
+        for (int tile = tileBegin; tile < tileEnd; tile++) {
+            int startX = (tile % m_rangeTilesPerSide) * RANGE_TILE_SIZE;
+            int startZ = (tile / m_rangeTilesPerSide) * RANGE_TILE_SIZE;
+            int count = std::min(RANGE_TILE_SIZE, m_heightmapResolution - startX);
+            int endZ = std::min(startZ + RANGE_TILE_SIZE, m_heightmapResolution);
+            float tileMin = FLT_MAX;
+            float tileMax = -FLT_MAX;
+            for (int z = startZ; z < endZ; z++) {
+                const float* noise = base.noise->GetRow(z) + startX;
+                const float* offsets = sculpt ? sculpt->GetRow(z) + startX : nullptr;
+                float* row = m_heights.GetRow(z) + startX;
+                for (int i = 0; i < count; i++) {
+                    float height = noise[i] * amplitude + (offsets ? offsets[i] : 0.f);
+                    row[i] = height;
+                    tileMin = std::min(tileMin, height);
+                    tileMax = std::max(tileMax, height);
+                }
             }
+            m_tileRanges[tile] = glm::vec2(tileMin, tileMax);
+        }
+    });
+    std::fill(m_staleTiles.begin(), m_staleTiles.end(), uint8_t(0));
+    m_hasStaleTiles = false;
+
+    if (!sculpt) {
+        //a negative amplitude swaps the ends of the range
+        m_minHeight = std::min(base.noiseMin * amplitude, base.noiseMax * amplitude);
+        m_maxHeight = std::max(base.noiseMin * amplitude, base.noiseMax * amplitude);
+        return true;
+    }
+    m_minHeight = FLT_MAX;
+    m_maxHeight = -FLT_MAX;
+    for (const glm::vec2& range : m_tileRanges) {
+        m_minHeight = std::min(m_minHeight, range.x);
+        m_maxHeight = std::max(m_maxHeight, range.y);
+    }
+    return true;
+}
 
-            SetHeight(i, j, height);
+void Heightmap::SetSculptLayer(const HeightField& offsets) {
+    m_sculptLayer = std::make_shared<HeightField>(m_heightmapResolution);
+    int sourceResolution = offsets.GetResolution();
+    for (int z = 0; z < m_heightmapResolution; z++) {
+        int sourceZ = sourceResolution == m_heightmapResolution ? z : int(std::lround(float(z) / (m_heightmapResolution - 1) * (sourceResolution - 1)));
+        float* row = m_sculptLayer->GetRow(z);
+        const float* sourceRow = offsets.GetRow(sourceZ);
+        if (sourceResolution == m_heightmapResolution) {
+            std::memcpy(row, sourceRow, m_heightmapResolution * sizeof(float));
+            continue;
         }
+        for (int x = 0; x < m_heightmapResolution; x++) {
+            row[x] = sourceRow[std::lround(float(x) / (m_heightmapResolution - 1) * (sourceResolution - 1))];
+        }
+    }
+    m_layersDirtyRegion.Include(LayerCompositor::GetMaskRegion(HeightmapLayerSettings(), m_heightmapSize, m_heightmapResolution));
+}
+
+//snapshots handed to background generation share the sculpt layer, it is copied before it changes under them
+HeightField& Heightmap::GetWritableSculptLayer() {
+    if (!m_sculptLayer) {
+        m_sculptLayer = std::make_shared<HeightField>(m_heightmapResolution);
+    }
+    else if (m_sculptLayer.use_count() > 1) {
+        m_sculptLayer = std::make_shared<HeightField>(*m_sculptLayer);
     }
+    return *m_sculptLayer;
+}
+
+//heights that don't come from noise have nothing to compose from
+void Heightmap::ClearLayers() {
+    m_layers.clear();
+    m_sculptLayer.reset();
+    m_layersDirtyRegion.Reset();
 }
 
 const float Heightmap::GetHeight(int x, int z) const {
@@ -59,78 +228,197 @@ const float Heightmap::GetHeight(int x, int z) const {
         z < 0 || z >= m_heightmapResolution) {
         return 0.f;
     }
-    return m_map[z * m_heightmapResolution + x];
+    return m_heights.Get(x, z);
+}
+
+// height of the texel under a world position. terrain coords go from -size to +size
+const float Heightmap::GetHeightFromWorld(int pointX, int pointZ) const {
+    float normalizedX = (pointX / m_heightmapSize + 1.f) * 0.5f; //[0, 1]
+    float normalizedZ = (pointZ / m_heightmapSize + 1.f) * 0.5f;
+
+    int gridX = int(normalizedX * m_heightmapResolution);
+    int gridZ = int(normalizedZ * m_heightmapResolution);
+
+    return GetHeight(gridX, gridZ);
 }
 
 void Heightmap::SetSize(float size){
     m_heightmapSize = size;
     m_heightmapResolution = size * 2;
-    m_map = std::make_unique<float[]>(m_heightmapResolution * m_heightmapResolution);
+    m_heights = HeightField(m_heightmapResolution);
+    ResetHeightRange(0.f);
+    ClearLayers();
+    m_dirtyRegion.Reset();
+    MarkAllDirty();
 }
 
-void Heightmap::SetHeight(int x, int z, float height)
-{
-    if (x < 0 || x >= m_heightmapResolution ||
-        z < 0 || z >= m_heightmapResolution) {
-        return;
-    }
-    if (height < m_minHeight) {
-        m_minHeight = height;
-    }
-    if (height > m_maxHeight) {
-        m_maxHeight = height;
-    }
-    m_map[z * m_heightmapResolution + x] = height;
+//replaces every height of the map, and scans the new height range
+void Heightmap::SetHeights(const float* heights) {
+    std::memcpy(m_heights.GetData(), heights, m_heights.GetTexelCount() * sizeof(float));
+    ClearLayers();
+    MarkAllDirty();
+    MarkRangeStale(m_dirtyRegion);
+    UpdateHeightRange();
 }
 
+//replaces every height of the map with a range that is already known, so the heights are only copied. bands are copied
+//on the thread pool, which lets the page faults of a memory mapped source overlap. the tiles are scanned by the first
+//UpdateHeightRange after an edit
+void Heightmap::SetHeights(const float* heights, float minHeight, float maxHeight) {
+    util::ThreadPool::Get().ParallelFor(0, m_heightmapResolution, 64, [&](int rowBegin, int rowEnd) {
+        size_t begin = size_t(rowBegin) * m_heightmapResolution;
+        size_t end = size_t(rowEnd) * m_heightmapResolution;
+        std::copy(heights + begin, heights + end, m_heights.GetData() + begin);
+    });
 
-// fbm params
-float Heightmap::fBm(glm::vec2 position) {
-    const int octaves = 5;           //number of fbm octaves
-    const float lacunarity = 1.9f;  //freq multiplier per octave
-    const float gain = 0.5f;        //amplitude multiplier per octave
+    ClearLayers();
+    MarkAllDirty();
+    MarkRangeStale(m_dirtyRegion);
+    m_minHeight = minHeight;
+    m_maxHeight = maxHeight;
+}
 
-    float accumulatedNoise = 0.f;  //final fbm value
-    float amplitude = 0.5f;
-    float freq = Frequency;
-    float prev = 1.f; //previous noise val
+//copies a region in row bands on the thread pool. like SetHeight the change goes into the sculpt layer when there are
+//layers, and the range is only widened. the tiles the region touches are rescanned by the next UpdateHeightRange, once
+//per frame rather than once per brush application
+void Heightmap::SetHeights(const HeightField& heights, const HeightmapRegion& region) {
+    if (!region.IsEmpty()) {
+        SetHeights(heights.GetView(region), region);
+    }
+}
 
-    for (int i = 0; i < octaves; ++i) {
-        float noise = SampleNoise(position.x * freq, position.y * freq);
+void Heightmap::SetHeights(const HeightFieldView<const float>& heights, const HeightmapRegion& region) {
+    if (region.IsEmpty()) {
+        return;
+    }
 
-        float ridgeNoise = 1.f - std::abs(noise);
+    HeightField* sculptLayer = m_layers.empty() ? nullptr : &GetWritableSculptLayer();
+    const int rowsPerBand = 16;
+    int width = region.GetWidth();
+    int bandCount = (region.GetHeight() + rowsPerBand - 1) / rowsPerBand;
+    std::vector<float> bandMinHeights(bandCount, FLT_MAX);
+    std::vector<float> bandMaxHeights(bandCount, -FLT_MAX);
 
-        //smoothing functions for valleys and peaks
-        if (ridgeNoise < .5f) {
-            ridgeNoise = 4.f * glm::pow(ridgeNoise, 3); // valleys
-        }
-        else {
-            ridgeNoise = (ridgeNoise - 1.f) * glm::pow((2.f * ridgeNoise - 2.f), 2) + 1.f; //peaks
+    util::ThreadPool::Get().ParallelFor(region.minZ, region.maxZ + 1, rowsPerBand, [&](int rowBegin, int rowEnd) {
+        float minHeight = FLT_MAX;
+        float maxHeight = -FLT_MAX;
+        for (int z = rowBegin; z < rowEnd; z++) {
+            const float* source = heights.GetRow(z - region.minZ);
+            float* row = m_heights.GetRow(z) + region.minX;
+            float* offsets = sculptLayer ? sculptLayer->GetRow(z) + region.minX : nullptr;
+            for (int i = 0; i < width; i++) {
+                if (offsets) {
+                    offsets[i] += source[i] - row[i];
+                }
+                row[i] = source[i];
+                minHeight = std::min(minHeight, source[i]);
+                maxHeight = std::max(maxHeight, source[i]);
+            }
         }
+        int band = (rowBegin - region.minZ) / rowsPerBand;
+        bandMinHeights[band] = minHeight;
+        bandMaxHeights[band] = maxHeight;
+    });
 
-        accumulatedNoise += ridgeNoise * amplitude * prev;
+    for (int band = 0; band < bandCount; band++) {
+        m_minHeight = std::min(m_minHeight, bandMinHeights[band]);
+        m_maxHeight = std::max(m_maxHeight, bandMaxHeights[band]);
+    }
+    m_dirtyRegion.Include(region);
+    MarkRangeStale(region);
+}
 
-        prev = ridgeNoise;
+void Heightmap::ResetHeightRange(float height) {
+    m_rangeTilesPerSide = (m_heightmapResolution + RANGE_TILE_SIZE - 1) / RANGE_TILE_SIZE;
+    size_t tileCount = size_t(m_rangeTilesPerSide) * m_rangeTilesPerSide;
+    m_tileRanges.assign(tileCount, glm::vec2(height));
+    m_staleTiles.assign(tileCount, 0);
+    m_hasStaleTiles = false;
+    m_minHeight = height;
+    m_maxHeight = height;
+}
 
-        //adjust for next octave
-        freq *= lacunarity;
-        amplitude *= gain;
+void Heightmap::MarkRangeStale(const HeightmapRegion& region) {
+    if (region.IsEmpty()) {
+        return;
     }
-
-    float maxDistance = std::sqrt(2.f);
-    float distance = glm::length(position);
-    float linear = glm::clamp(1.f - distance / maxDistance, 0.f, 1.f); // create mountain ranges more towards the middle
-    float falloff = linear* linear* (3 - 2 * linear); //smooth interpolation
-    return accumulatedNoise * falloff;
+    for (int tileZ = region.minZ / RANGE_TILE_SIZE; tileZ <= region.maxZ / RANGE_TILE_SIZE; tileZ++) {
+        for (int tileX = region.minX / RANGE_TILE_SIZE; tileX <= region.maxX / RANGE_TILE_SIZE; tileX++) {
+            m_staleTiles[size_t(tileZ) * m_rangeTilesPerSide + tileX] = 1;
+        }
+    }
+    m_hasStaleTiles = true;
 }
 
-float Heightmap::SampleNoise(float x, float y) {
-    return m_noise.GetNoise(x * m_heightmapSize, y * m_heightmapSize);
+//the stale tiles are rescanned on the thread pool, then the map's range is folded from all tile ranges. a brush stroke
+//touches a handful of tiles and even a 4k map has only 4096 of them, so this stays far below a full scan
+void Heightmap::UpdateHeightRange() {
+    if (!m_hasStaleTiles) {
+        return;
+    }
+
+    std::vector<int> staleTiles;
+    for (size_t tile = 0; tile < m_staleTiles.size(); tile++) {
+        if (m_staleTiles[tile]) {
+            staleTiles.push_back(int(tile));
+            m_staleTiles[tile] = 0;
+        }
+    }
+
+    util::ThreadPool::Get().ParallelFor(0, int(staleTiles.size()), 1, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            int tile = staleTiles[i];
+            int startX = (tile % m_rangeTilesPerSide) * RANGE_TILE_SIZE;
+            int startZ = (tile / m_rangeTilesPerSide) * RANGE_TILE_SIZE;
+            int endX = std::min(startX + RANGE_TILE_SIZE, m_heightmapResolution);
+            int endZ = std::min(startZ + RANGE_TILE_SIZE, m_heightmapResolution);
+            float tileMin = FLT_MAX;
+            float tileMax = -FLT_MAX;
+            for (int z = startZ; z < endZ; z++) {
+                const float* row = m_heights.GetRow(z);
+                for (int x = startX; x < endX; x++) {
+                    tileMin = std::min(tileMin, row[x]);
+                    tileMax = std::max(tileMax, row[x]);
+                }
+            }
+            m_tileRanges[tile] = glm::vec2(tileMin, tileMax);
+        }
+    });
+
+    m_minHeight = FLT_MAX;
+    m_maxHeight = -FLT_MAX;
+    for (const glm::vec2& range : m_tileRanges) {
+        m_minHeight = std::min(m_minHeight, range.x);
+        m_maxHeight = std::max(m_maxHeight, range.y);
+    }
+    m_hasStaleTiles = false;
 }
 
-void Heightmap::Update() {
-    glBindTexture(GL_TEXTURE_2D, m_textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_heightmapResolution, m_heightmapResolution, 0, GL_RED, GL_FLOAT, m_map.get());
-    glBindTexture(GL_TEXTURE_2D, 0);
+void Heightmap::SetNoiseSeed(float noiseSeed) {
+    m_noiseSeed = noiseSeed;
 }
 
+void Heightmap::SetHeight(int x, int z, float height)
+{
+    if (x < 0 || x >= m_heightmapResolution ||
+        z < 0 || z >= m_heightmapResolution) {
+        return;
+    }
+    //heights composed from layers keep the change as a sculpt offset, so it survives the layers changing
+    if (!m_layers.empty()) {
+        HeightField& sculptLayer = GetWritableSculptLayer();
+        sculptLayer.Set(x, z, sculptLayer.Get(x, z) + height - m_heights.Get(x, z));
+    }
+
+    //a single texel isn't worth rescanning its tile for, the range is widened now and made exact by UpdateHeightRange
+    if (height < m_minHeight) {
+        m_minHeight = height;
+    }
+    if (height > m_maxHeight) {
+        m_maxHeight = height;
+    }
+    m_heights.Set(x, z, height);
+    m_dirtyRegion.Include(x, z);
+    m_staleTiles[size_t(z / RANGE_TILE_SIZE) * m_rangeTilesPerSide + x / RANGE_TILE_SIZE] = 1;
+    m_hasStaleTiles = true;
+}
@@ -1,12 +1,22 @@
 #pragma once
+#include <atomic>
 #include <iostream>
 #include <time.h>
 #include <memory>
-#include <glad/glad.h>
-#include <FastNoise/FastNoise.h>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
 #include <glm/glm.hpp>
-#include "../engine/data_factory.h"
+#include "height_field.h"
+#include "heightmap_layers.h"
 
+// Heights of the terrain and the noise they were generated with. Only CPU data, the GPU copy is a HeightmapTexture
+// that follows the dirty region, so heightmaps can be generated and edited on any thread without a GL context.
+//
+// Heights generated from noise are a stack of layers: the base noise, more noise layers blended on top of it, and the
+// sculpting kept as a layer of offsets. Every layer caches its noise, so changing one layer only generates that layer
+// and recomposes the texels it covers, and regenerating the base noise keeps the sculpting.
 class Heightmap {
 public:
     //prevent copying
@@ -19,37 +29,95 @@ public:
 
     Heightmap() = default;
     ~Heightmap() = default;
-    Heightmap(float size, int resolution, float noiseSeed, DataFactory dataFactory);
+    Heightmap(float size, int resolution, float noiseSeed);
+    Heightmap(float size, int resolution);
 
-    void GenerateHeightsUsingNoise(int noiseType, float noiseSeed);
-    void Update();
+    // regenerates the base layer, layers on top and the sculpting are kept. cancelled is polled between row bands and
+    // progress follows the finished rows, both are optional so background generation can drop stale jobs. returns
+    // false if the heights were left incomplete by a cancel
+    bool GenerateHeightsUsingNoise(int noiseType, float noiseSeed, const std::atomic<bool>* cancelled = nullptr, std::atomic<float>* progress = nullptr);
 
-    const GLuint GetTextureID() const { return m_textureID; }
+    // layer 0 is the base noise the others are stacked on. heights that don't come from noise have no layers
+    int GetLayerCount() const { return int(m_layers.size()); }
+    const std::vector<HeightmapLayer>& GetLayers() const { return m_layers; }
+    const HeightmapLayerSettings& GetLayerSettings(int index) const { return m_layers[index].settings; }
+    // layer changes take effect with UpdateLayers. a layer can only be added on top of a base layer
+    void SetLayerSettings(int index, const HeightmapLayerSettings& settings);
+    bool AddLayer(const HeightmapLayerSettings& settings);
+    void RemoveLayer(int index);
+    // takes over layers, with their cached noise, from another heightmap
+    void SetLayers(const std::vector<HeightmapLayer>& layers);
+    // true if every layer has its noise cached, so UpdateLayers only has to compose
+    bool HasLayerNoise() const;
+    // generates the noise layers are missing and recomposes the texels the changes since the last update cover. when
+    // only the base layer is switched on, a change to the whole map like a new amplitude is a single scaling pass
+    bool UpdateLayers(const std::atomic<bool>* cancelled = nullptr, std::atomic<float>* progress = nullptr);
+    // offsets sculpted on top of the layers, null before the first change
+    std::shared_ptr<const HeightField> GetSculptLayer() const { return m_sculptLayer; }
+    // copies sculpt offsets, resampled to the nearest texel if they come from another resolution
+    void SetSculptLayer(const HeightField& offsets);
+
+    // lowest and highest height of the map. exact after every change but SetHeight and the SetHeights that copy a region,
+    // which only widen the range until UpdateHeightRange counts the change in
     const float GetMinHeight() const { return m_minHeight; }
     const float GetMaxHeight() const { return m_maxHeight; }
+    // rescans the tiles changed since the last update and takes the map's range from the tiles, so lowering a peak
+    // lowers the maximum without scanning the whole map
+    void UpdateHeightRange();
     const float GetSize() const { return m_heightmapSize; }
     const float GetResolution() const { return m_heightmapResolution; }
     const float GetHeight(int x, int z) const;
-    const float GetNoiseSeed() const { return m_noise.GetSeed(); }
+    const float GetHeightFromWorld(int pointX, int pointZ) const;
+    const float* GetHeights() const { return m_heights.GetData(); }
+    const HeightField& GetHeightField() const { return m_heights; }
+    const float GetNoiseSeed() const { return m_noiseSeed; }
+    // texels changed since the dirty region was last cleared. after regeneration the whole map is dirty
+    const HeightmapRegion& GetDirtyRegion() const { return m_dirtyRegion; }
+    void ClearDirtyRegion() { m_dirtyRegion.Reset(); }
 
     void SetSize(float size);
-    void SetMaxHeight(float maxHeight) { m_maxHeight = maxHeight; }
-    void SetMinHeight(float minHeight) { m_maxHeight = minHeight; }
     void SetHeight(int x, int z, float height);
+    void SetHeights(const float* heights);
+    void SetHeights(const float* heights, float minHeight, float maxHeight);
+    // copies the region from a grid of the same resolution, for simulations that work on their own copy of the heights.
+    // heights composed from layers keep the change as sculpt offsets
+    void SetHeights(const HeightField& heights, const HeightmapRegion& region);
+    // the same for heights that only cover the region, like a brush footprint
+    void SetHeights(const HeightFieldView<const float>& heights, const HeightmapRegion& region);
+    void SetNoiseSeed(float noiseSeed);
 
     float Amplitude = 80.f;
     float Frequency = 0.25f;
 
 private:
-    float fBm(glm::vec2 position);
-    float SampleNoise(float x, float y);
+    // side of the tiles the height range is kept for, in texels
+    static const int RANGE_TILE_SIZE = 64;
+
+    void MarkAllDirty();
+    void ClearLayers();
+    // recomposes the whole map from the base layer and the sculpting, false if a layer above is switched on
+    bool ComposeBaseLayer();
+    HeightField& GetWritableSculptLayer();
+    // tile ranges of a map whose texels all have the same height
+    void ResetHeightRange(float height);
+    void MarkRangeStale(const HeightmapRegion& region);
 
-    FastNoise m_noise;
-    GLuint m_textureID;
     int m_heightmapResolution;
-    std::unique_ptr<float[]> m_map;
+    HeightField m_heights;
     float m_heightmapSize;
     float m_maxHeight;
     float m_minHeight;
     float m_noiseSeed;
+
+    std::vector<HeightmapLayer> m_layers;
+    //shared with snapshots handed to background generation, copied before it is changed while shared
+    std::shared_ptr<HeightField> m_sculptLayer;
+    HeightmapRegion m_layersDirtyRegion; // texels UpdateLayers has to recompose
+
+    HeightmapRegion m_dirtyRegion;
+
+    std::vector<glm::vec2> m_tileRanges; // (min, max) per tile, row major
+    std::vector<uint8_t> m_staleTiles; // tiles changed since their range was taken
+    bool m_hasStaleTiles = false;
+    int m_rangeTilesPerSide = 0;
 };
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include <cfloat>
+#include <cmath>
+#include <FastNoise/FastNoise.h>
+#include <glm/glm.hpp>
+#include "heightmap_layers.h"
+#include "../util/thread_pool.h"
+
+static float SampleNoise(const FastNoise& noise, float size, float x, float y) {
+    return noise.GetNoise(x * size, y * size);
+}
+
+// fbm params
+// evaluates fbm for count points along the row y, one octave at a time across the whole batch
+template<int BatchSize>
+static void fBm(const FastNoise& noise, float size, float frequency, const float* x, float y, int count, float* out) {
+    const int octaves = 5;           //number of fbm octaves
+    const float lacunarity = 1.9f;  //freq multiplier per octave
+    const float gain = 0.5f;        //amplitude multiplier per octave
+
+    float accumulatedNoise[BatchSize];  //final fbm value
+    float prev[BatchSize]; //previous noise val
+    for (int lane = 0; lane < count; ++lane) {
+        accumulatedNoise[lane] = 0.f;
+        prev[lane] = 1.f;
+    }
+
+    float amplitude = 0.5f;
+    float freq = frequency;
+
+    for (int i = 0; i < octaves; ++i) {
+        for (int lane = 0; lane < count; ++lane) {
+            float sample = SampleNoise(noise, size, x[lane] * freq, y * freq);
+
+            float ridgeNoise = 1.f - std::abs(sample);
+
+            //smoothing functions for valleys and peaks
+            if (ridgeNoise < .5f) {
+                ridgeNoise = 4.f * glm::pow(ridgeNoise, 3); // valleys
+            }
+            else {
+                ridgeNoise = (ridgeNoise - 1.f) * glm::pow((2.f * ridgeNoise - 2.f), 2) + 1.f; //peaks
+            }
+
+            accumulatedNoise[lane] += ridgeNoise * amplitude * prev[lane];
+
+            prev[lane] = ridgeNoise;
+        }
+
+        //adjust for next octave
+        freq *= lacunarity;
+        amplitude *= gain;
+    }
+
+    float maxDistance = std::sqrt(2.f);
+    for (int lane = 0; lane < count; ++lane) {
+        float distance = glm::length(glm::vec2(x[lane], y));
+        float linear = glm::clamp(1.f - distance / maxDistance, 0.f, 1.f); // create mountain ranges more towards the middle
+        float falloff = linear * linear * (3 - 2 * linear); //smooth interpolation
+        out[lane] = accumulatedNoise[lane] * falloff;
+    }
+}
+
+//split the grid into row bands and sample them on the thread pool. every texel only depends on its own coordinates,
+//so the result is identical to walking the grid on a single thread
+std::shared_ptr<HeightField> LayerCompositor::GenerateNoise(const HeightmapLayerSettings& settings, float size, int resolution,
+    float& noiseMin, float& noiseMax, const std::atomic<bool>* cancelled, std::atomic<float>* progress) {
+    FastNoise noise;
+    noise.SetSeed(int(settings.noiseSeed));
+    if (settings.noiseType == 0) {
+        noise.SetNoiseType(FastNoise::SimplexFractal);
+        noise.SetFractalOctaves(5);
+    }
+    else {
+        noise.SetNoiseType(FastNoise::Simplex);
+        noise.SetFractalOctaves(5);
+    }
+
+    std::shared_ptr<HeightField> field = std::make_shared<HeightField>(resolution);
+    const int rowsPerBand = 16;
+    const int bandCount = (resolution + rowsPerBand - 1) / rowsPerBand;
+    std::vector<float> bandMinHeights(bandCount, FLT_MAX);
+    std::vector<float> bandMaxHeights(bandCount, -FLT_MAX);
+    std::atomic<int> finishedRows{ 0 };
+
+    util::ThreadPool::Get().ParallelFor(0, resolution, rowsPerBand, [&](int rowBegin, int rowEnd) {
+        if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        //NOISE_BATCH_SIZE texels at a time, so fbm can run one octave across the whole batch
+        float batchX[NOISE_BATCH_SIZE];
+        float batchHeights[NOISE_BATCH_SIZE];
+        float minHeight = FLT_MAX;
+        float maxHeight = -FLT_MAX;
+
+        for (int j = rowBegin; j < rowEnd; ++j) {
+            float y = float(j) / float(resolution - 1) * 2.f - 1.f;
+            float* row = field->GetRow(j);
+
+            for (int i = 0; i < resolution; i += NOISE_BATCH_SIZE) {
+                int count = std::min(int(NOISE_BATCH_SIZE), resolution - i);
+                for (int lane = 0; lane < count; ++lane) {
+                    batchX[lane] = float(i + lane) / float(resolution - 1) * 2.f - 1.f;
+                }
+
+                if (settings.noiseType == 0) {
+                    for (int lane = 0; lane < count; ++lane) {
+                        batchHeights[lane] = SampleNoise(noise, size, batchX[lane] * settings.frequency, y * settings.frequency);
+                    }
+                }
+                else {
+                    fBm<NOISE_BATCH_SIZE>(noise, size, settings.frequency, batchX, y, count, batchHeights);
+                }
+
+                for (int lane = 0; lane < count; ++lane) {
+                    float height = batchHeights[lane];
+                    minHeight = std::min(minHeight, height);
+                    maxHeight = std::max(maxHeight, height);
+                    row[i + lane] = height;
+                }
+            }
+        }
+
+        bandMinHeights[rowBegin / rowsPerBand] = minHeight;
+        bandMaxHeights[rowBegin / rowsPerBand] = maxHeight;
+        int rows = finishedRows.fetch_add(rowEnd - rowBegin) + rowEnd - rowBegin;
+        if (progress) {
+            progress->store(float(rows) / float(resolution));
+        }
+    });
+
+    if (cancelled && cancelled->load()) {
+        return nullptr;
+    }
+
+    noiseMin = FLT_MAX;
+    noiseMax = -FLT_MAX;
+    for (int band = 0; band < bandCount; band++) {
+        noiseMin = std::min(noiseMin, bandMinHeights[band]);
+        noiseMax = std::max(noiseMax, bandMaxHeights[band]);
+    }
+    return field;
+}
+
+HeightmapRegion LayerCompositor::GetMaskRegion(const HeightmapLayerSettings& settings, float size, int resolution) {
+    HeightmapRegion region;
+    if (settings.maskRadius <= 0.f) {
+        region.Include(0, 0);
+        region.Include(resolution - 1, resolution - 1);
+        return region;
+    }
+
+    //world coords go from -size to +size across the grid
+    float texelsPerUnit = (resolution - 1) / (2.f * size);
+    float centerX = (settings.maskX + size) * texelsPerUnit;
+    float centerZ = (settings.maskZ + size) * texelsPerUnit;
+    float radius = settings.maskRadius * texelsPerUnit;
+
+    int startX = std::max(int(std::floor(centerX - radius)), 0);
+    int startZ = std::max(int(std::floor(centerZ - radius)), 0);
+    int endX = std::min(int(std::ceil(centerX + radius)), resolution - 1);
+    int endZ = std::min(int(std::ceil(centerZ + radius)), resolution - 1);
+    if (startX <= endX && startZ <= endZ) {
+        region.Include(startX, startZ);
+        region.Include(endX, endZ);
+    }
+    return region;
+}
+
+//blends value into height with weight, for one row of a tile. the mode is picked outside the loop so the loop stays simple
+static void BlendRow(LayerBlendMode blendMode, const float* noise, float amplitude, const float* weights, int count, float* heights) {
+    switch (blendMode) {
+    case LayerBlendMode::Add:
+        for (int i = 0; i < count; i++) {
+            heights[i] += noise[i] * amplitude * weights[i];
+        }
+        break;
+    case LayerBlendMode::Subtract:
+        for (int i = 0; i < count; i++) {
+            heights[i] -= noise[i] * amplitude * weights[i];
+        }
+        break;
+    case LayerBlendMode::Max:
+        for (int i = 0; i < count; i++) {
+            heights[i] += (std::max(heights[i], noise[i] * amplitude) - heights[i]) * weights[i];
+        }
+        break;
+    case LayerBlendMode::Min:
+        for (int i = 0; i < count; i++) {
+            heights[i] += (std::min(heights[i], noise[i] * amplitude) - heights[i]) * weights[i];
+        }
+        break;
+    }
+}
+
+//weight of a layer along part of a row: opacity, faded by the stamp mask if there is one
+static void GetRowWeights(const HeightmapLayerSettings& settings, float size, int resolution, int z, int startX, int count, float* weights) {
+    if (settings.maskRadius <= 0.f) {
+        std::fill(weights, weights + count, settings.opacity);
+        return;
+    }
+
+    float worldZ = (float(z) / (resolution - 1) * 2.f - 1.f) * size;
+    float innerRadius = settings.maskRadius * (1.f - glm::clamp(settings.maskFalloff, 0.f, 1.f));
+    for (int i = 0; i < count; i++) {
+        float worldX = (float(startX + i) / (resolution - 1) * 2.f - 1.f) * size;
+        float distance = glm::length(glm::vec2(worldX - settings.maskX, worldZ - settings.maskZ));
+        float weight = 1.f - glm::smoothstep(innerRadius, settings.maskRadius, distance);
+        weights[i] = weight * settings.opacity;
+    }
+}
+
+void LayerCompositor::Composite(const std::vector<HeightmapLayer>& layers, const HeightField* sculpt, float size,
+    const HeightmapRegion& region, HeightField& heights) {
+    if (region.IsEmpty() || layers.empty()) {
+        return;
+    }
+
+    int resolution = heights.GetResolution();
+    int tilesX = (region.GetWidth() + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesZ = (region.GetHeight() + TILE_SIZE - 1) / TILE_SIZE;
+
+    //layers that can't change anything in a tile are skipped per tile
+    std::vector<HeightmapRegion> layerRegions;
+    for (const HeightmapLayer& layer : layers) {
+        layerRegions.push_back(GetMaskRegion(layer.settings, size, resolution));
+    }
+
+    util::ThreadPool::Get().ParallelFor(0, tilesX * tilesZ, 1, [&](int tileBegin, int tileEnd) {
+        float weights[TILE_SIZE];
+
+        for (int tile = tileBegin; tile < tileEnd; tile++) {
+            int startX = region.minX + (tile % tilesX) * TILE_SIZE;
+            int startZ = region.minZ + (tile / tilesX) * TILE_SIZE;
+            int endX = std::min(startX + TILE_SIZE - 1, region.maxX);
+            int endZ = std::min(startZ + TILE_SIZE - 1, region.maxZ);
+            int count = endX - startX + 1;
+
+            for (int z = startZ; z <= endZ; z++) {
+                float* row = heights.GetRow(z) + startX;
+
+                const HeightmapLayer& base = layers[0];
+                const float* baseNoise = base.noise->GetRow(z) + startX;
+                for (int i = 0; i < count; i++) {
+                    row[i] = baseNoise[i] * base.settings.amplitude;
+                }
+
+                for (size_t layerIndex = 1; layerIndex < layers.size(); layerIndex++) {
+                    const HeightmapLayer& layer = layers[layerIndex];
+                    const HeightmapRegion& layerRegion = layerRegions[layerIndex];
+                    if (!layer.settings.enabled || layer.settings.opacity <= 0.f || z < layerRegion.minZ || z > layerRegion.maxZ ||
+                        endX < layerRegion.minX || startX > layerRegion.maxX) {
+                        continue;
+                    }
+                    GetRowWeights(layer.settings, size, resolution, z, startX, count, weights);
+                    BlendRow(layer.settings.blendMode, layer.noise->GetRow(z) + startX, layer.settings.amplitude, weights, count, row);
+                }
+
+                if (sculpt) {
+                    const float* offsets = sculpt->GetRow(z) + startX;
+                    for (int i = 0; i < count; i++) {
+                        row[i] += offsets[i];
+                    }
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "height_field.h"
+
+// How a layer is combined with the layers below it
+enum class LayerBlendMode {
+	Add,
+	Subtract,
+	Max,
+	Min
+};
+
+struct HeightmapLayerSettings {
+	//noise
+	int noiseType = 0;
+	float noiseSeed = 0.f;
+	float frequency = 0.25f;
+	float amplitude = 80.f;
+
+	//composition, ignored for the base layer which the others are stacked on
+	bool enabled = true;
+	LayerBlendMode blendMode = LayerBlendMode::Add;
+	float opacity = 1.f;
+
+	// a stamp confines the layer to a circle in world units, fading out over the outer falloff part of the radius.
+	// a radius of 0 covers the whole map
+	float maskX = 0.f;
+	float maskZ = 0.f;
+	float maskRadius = 0.f;
+	float maskFalloff = 0.5f;
+
+	// true if both settings produce the same noise, so cached noise can be reused
+	bool HasSameNoise(const HeightmapLayerSettings& other) const {
+		return noiseType == other.noiseType && noiseSeed == other.noiseSeed && frequency == other.frequency;
+	}
+};
+
+// One layer of a heightmap and its noise before amplitude. The noise is never changed once generated, so heightmaps
+// built from the same layers share it
+struct HeightmapLayer {
+	HeightmapLayerSettings settings;
+	std::shared_ptr<const HeightField> noise;
+	HeightmapLayerSettings noiseSettings; // what the noise was generated with
+	float noiseMin = 0.f;
+	float noiseMax = 0.f;
+
+	bool HasNoise(int resolution) const {
+		return noise && noise->GetResolution() == resolution && noiseSettings.HasSameNoise(settings);
+	}
+};
+
+// Generates layer noise and composes layers into heights.
+//
+// Heights are the base layer's noise * amplitude, every enabled layer above blended on top with its opacity and mask,
+// and the sculpt offsets added last. Composing is done in tiles on the thread pool and can be limited to a region, so
+// a change to a stamp or a single layer's amplitude only touches the texels it affects.
+class LayerCompositor {
+public:
+	// cancelled and progress work like in Heightmap::GenerateHeightsUsingNoise. returns nullptr if cancelled
+	static std::shared_ptr<HeightField> GenerateNoise(const HeightmapLayerSettings& settings, float size, int resolution,
+		float& noiseMin, float& noiseMax, const std::atomic<bool>* cancelled = nullptr, std::atomic<float>* progress = nullptr);
+
+	// composes the heights of the region. every layer needs its noise, sculpt may be null
+	static void Composite(const std::vector<HeightmapLayer>& layers, const HeightField* sculpt, float size,
+		const HeightmapRegion& region, HeightField& heights);
+
+	// texels a layer's mask lets through, the whole map without a mask
+	static HeightmapRegion GetMaskRegion(const HeightmapLayerSettings& settings, float size, int resolution);
+
+private:
+	static const int NOISE_BATCH_SIZE = 8;
+	static const int TILE_SIZE = 64;
+};
@@ -0,0 +1,51 @@
+#include "heightmap_texture.h"
+#include "../engine/gl_state.h"
+#include "../engine/upload_ring.h"
+
+HeightmapTexture::HeightmapTexture(const HeightField& heights, DataFactory dataFactory) : HeightmapTexture(heights.GetResolution(), dataFactory) {
+    HeightmapRegion wholeField;
+    wholeField.Include(0, 0);
+    wholeField.Include(heights.GetResolution() - 1, heights.GetResolution() - 1);
+    Update(heights, wholeField);
+}
+
+HeightmapTexture::HeightmapTexture(int resolution, DataFactory dataFactory) {
+    m_textureID = dataFactory.CreateTexture();
+    GLState::Get().BindTextureForEdit(GL_TEXTURE_2D, m_textureID); // make heightmap texture configurable
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // prevent horizontal wrapping outside of [0,1]
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); // same but for vertical
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // linearly interpolate texture values between neighbor textures to look smoother
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // same but for larger sample size
+    Allocate(resolution);
+}
+
+void HeightmapTexture::Allocate(int resolution) {
+    if (m_textureID == 0) {
+        return;
+    }
+    GLState::Get().BindTextureForEdit(GL_TEXTURE_2D, m_textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, resolution, resolution, 0, GL_RED, GL_FLOAT, nullptr);
+    m_resolution = resolution;
+}
+
+//regeneration sends the whole field, sculpting only the bounding box of the texels it touched. both go through the upload
+//ring, so the copy to the GPU doesn't wait for draws that still sample the texture
+void HeightmapTexture::Update(const HeightField& heights, const HeightmapRegion& region) {
+    if (m_textureID == 0 || region.IsEmpty()) {
+        return;
+    }
+
+    int resolution = heights.GetResolution();
+    HeightmapRegion clipped;
+    clipped.Include(std::max(region.minX, 0), std::max(region.minZ, 0));
+    clipped.Include(std::min(region.maxX, resolution - 1), std::min(region.maxZ, resolution - 1));
+    //heights of a different resolution re-specify the texture and are sent whole
+    if (resolution != m_resolution) {
+        Allocate(resolution);
+        clipped.Include(0, 0);
+        clipped.Include(resolution - 1, resolution - 1);
+    }
+    HeightFieldView<const float> view = heights.GetView(clipped);
+    GLState::Get().BindTextureForEdit(GL_TEXTURE_2D, m_textureID);
+    UploadRing::Get().UploadTexture2D(GL_TEXTURE_2D, clipped.minX, clipped.minZ, view.width, view.height, GL_RED, GL_FLOAT, sizeof(float), view.data, view.stride);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <glad/glad.h>
+#include "height_field.h"
+#include "../engine/data_factory.h"
+
+// GPU copy of a height field as a single channel float texture. The heights stay owned by the CPU side, the texture
+// is brought up to date from the regions that changed since the last update.
+class HeightmapTexture {
+public:
+	HeightmapTexture() = default;
+	HeightmapTexture(const HeightField& heights, DataFactory dataFactory);
+	// texture with storage for the resolution but undefined texels, to be filled by updates
+	HeightmapTexture(int resolution, DataFactory dataFactory);
+
+	// re-specifies the storage for a resolution, the texels are undefined until the next update
+	void Allocate(int resolution);
+
+	// uploads the region of the heights through the upload ring. heights of a different resolution re-specify the
+	// texture and are uploaded whole
+	void Update(const HeightField& heights, const HeightmapRegion& region);
+
+	GLuint GetTextureID() const { return m_textureID; }
+	int GetResolution() const { return m_resolution; }
+
+private:
+	GLuint m_textureID = 0; // 0 without a GL context, updates do nothing then
+	int m_resolution = 0;
+};
@@ -0,0 +1,233 @@
+#include <cstring>
+#include "sculpt_history.h"
+
+//run length encoding of the byte planes. a control byte below 128 is a run of control + 1 zero bytes, anything else is
+//followed by control - 127 literal bytes
+static void EncodeZeroRuns(const std::vector<uint8_t>& bytes, std::vector<uint8_t>& encoded) {
+    size_t i = 0;
+    while (i < bytes.size()) {
+        size_t runEnd = i;
+        while (runEnd < bytes.size() && bytes[runEnd] == 0 && runEnd - i < 128) {
+            runEnd++;
+        }
+        if (runEnd > i) {
+            encoded.push_back(uint8_t(runEnd - i - 1));
+            i = runEnd;
+            continue;
+        }
+
+        //literals until the next pair of zeros, a single zero is cheaper to keep as a literal
+        size_t literalEnd = i;
+        while (literalEnd < bytes.size() && literalEnd - i < 128) {
+            if (bytes[literalEnd] == 0 && literalEnd + 1 < bytes.size() && bytes[literalEnd + 1] == 0) {
+                break;
+            }
+            literalEnd++;
+        }
+        encoded.push_back(uint8_t(127 + literalEnd - i));
+        encoded.insert(encoded.end(), bytes.begin() + i, bytes.begin() + literalEnd);
+        i = literalEnd;
+    }
+}
+
+static void DecodeZeroRuns(const std::vector<uint8_t>& encoded, std::vector<uint8_t>& bytes) {
+    size_t i = 0;
+    size_t out = 0;
+    while (i < encoded.size()) {
+        uint8_t control = encoded[i++];
+        if (control < 128) {
+            std::memset(&bytes[out], 0, control + 1);
+            out += control + 1;
+        }
+        else {
+            size_t literalCount = control - 127;
+            std::memcpy(&bytes[out], &encoded[i], literalCount);
+            i += literalCount;
+            out += literalCount;
+        }
+    }
+}
+
+SculptHistory::SculptHistory(size_t memoryBudget) : m_memoryBudget(memoryBudget) {
+}
+
+void SculptHistory::GetTileBounds(const Heightmap& heightmap, int tileX, int tileZ, HeightmapRegion& bounds) const {
+    int resolution = int(heightmap.GetResolution());
+    bounds.Reset();
+    bounds.Include(tileX * TILE_SIZE, tileZ * TILE_SIZE);
+    bounds.Include(std::min((tileX + 1) * TILE_SIZE, resolution) - 1, std::min((tileZ + 1) * TILE_SIZE, resolution) - 1);
+}
+
+void SculptHistory::RecordRegion(const Heightmap& heightmap, const HeightmapRegion& region) {
+    if (region.IsEmpty()) {
+        return;
+    }
+
+    int resolution = int(heightmap.GetResolution());
+    int tilesPerSide = (resolution + TILE_SIZE - 1) / TILE_SIZE;
+    int startTileX = std::max(region.minX, 0) / TILE_SIZE;
+    int startTileZ = std::max(region.minZ, 0) / TILE_SIZE;
+    int endTileX = std::min(region.maxX, resolution - 1) / TILE_SIZE;
+    int endTileZ = std::min(region.maxZ, resolution - 1) / TILE_SIZE;
+
+    for (int tileZ = startTileZ; tileZ <= endTileZ; tileZ++) {
+        for (int tileX = startTileX; tileX <= endTileX; tileX++) {
+            int tileIndex = tileZ * tilesPerSide + tileX;
+            if (m_strokeTiles.count(tileIndex)) {
+                continue;
+            }
+
+            HeightmapRegion bounds;
+            GetTileBounds(heightmap, tileX, tileZ, bounds);
+            std::vector<float>& heights = m_strokeTiles[tileIndex];
+            heights.reserve(bounds.GetWidth() * bounds.GetHeight());
+            for (int z = bounds.minZ; z <= bounds.maxZ; z++) {
+                for (int x = bounds.minX; x <= bounds.maxX; x++) {
+                    heights.push_back(heightmap.GetHeight(x, z));
+                }
+            }
+        }
+    }
+}
+
+void SculptHistory::EndStroke(const Heightmap& heightmap) {
+    if (m_strokeTiles.empty()) {
+        return;
+    }
+
+    int resolution = int(heightmap.GetResolution());
+    int tilesPerSide = (resolution + TILE_SIZE - 1) / TILE_SIZE;
+
+    Entry entry;
+    std::vector<uint8_t> planes;
+    for (const auto& [tileIndex, before] : m_strokeTiles) {
+        CompressedTile tile;
+        tile.tileX = tileIndex % tilesPerSide;
+        tile.tileZ = tileIndex / tilesPerSide;
+
+        HeightmapRegion bounds;
+        GetTileBounds(heightmap, tile.tileX, tile.tileZ, bounds);
+
+        //most significant bytes first, so the long zero runs of the sign and exponent bits end up next to each other
+        size_t texelCount = before.size();
+        planes.assign(texelCount * 4, 0);
+        bool changed = false;
+        size_t i = 0;
+        for (int z = bounds.minZ; z <= bounds.maxZ; z++) {
+            for (int x = bounds.minX; x <= bounds.maxX; x++, i++) {
+                float after = heightmap.GetHeight(x, z);
+                uint32_t beforeBits, afterBits;
+                std::memcpy(&beforeBits, &before[i], sizeof(float));
+                std::memcpy(&afterBits, &after, sizeof(float));
+                uint32_t difference = beforeBits ^ afterBits;
+                changed |= difference != 0;
+                for (int plane = 0; plane < 4; plane++) {
+                    planes[plane * texelCount + i] = uint8_t(difference >> (24 - plane * 8));
+                }
+            }
+        }
+
+        if (!changed) {
+            continue;
+        }
+        EncodeZeroRuns(planes, tile.data);
+        entry.byteSize += tile.data.size();
+        entry.tiles.push_back(std::move(tile));
+    }
+    m_strokeTiles.clear();
+
+    if (entry.tiles.empty()) {
+        return;
+    }
+
+    //a new stroke branches off the history, whatever was undone can't be redone anymore
+    for (const Entry& redoEntry : m_redoEntries) {
+        m_memoryUsage -= redoEntry.byteSize;
+    }
+    m_redoEntries.clear();
+
+    m_memoryUsage += entry.byteSize;
+    m_undoEntries.push_back(std::move(entry));
+    EvictOldest();
+}
+
+//XOR the entry into the heightmap. SetHeight marks the texels dirty, so only the tiles of the entry are uploaded and
+//rescanned for the height range, an undo that removes a peak lowers the range again
+void SculptHistory::ApplyEntry(Heightmap& heightmap, const Entry& entry) const {
+    std::vector<uint8_t> planes;
+    for (const CompressedTile& tile : entry.tiles) {
+        HeightmapRegion bounds;
+        GetTileBounds(heightmap, tile.tileX, tile.tileZ, bounds);
+        size_t texelCount = size_t(bounds.GetWidth()) * bounds.GetHeight();
+        planes.resize(texelCount * 4);
+        DecodeZeroRuns(tile.data, planes);
+
+        size_t i = 0;
+        for (int z = bounds.minZ; z <= bounds.maxZ; z++) {
+            for (int x = bounds.minX; x <= bounds.maxX; x++, i++) {
+                uint32_t difference = 0;
+                for (int plane = 0; plane < 4; plane++) {
+                    difference |= uint32_t(planes[plane * texelCount + i]) << (24 - plane * 8);
+                }
+                if (difference == 0) {
+                    continue;
+                }
+
+                float height = heightmap.GetHeight(x, z);
+                uint32_t bits;
+                std::memcpy(&bits, &height, sizeof(float));
+                bits ^= difference;
+                std::memcpy(&height, &bits, sizeof(float));
+                heightmap.SetHeight(x, z, height);
+            }
+        }
+    }
+    heightmap.UpdateHeightRange();
+}
+
+bool SculptHistory::Undo(Heightmap& heightmap) {
+    EndStroke(heightmap);
+    if (m_undoEntries.empty()) {
+        return false;
+    }
+
+    ApplyEntry(heightmap, m_undoEntries.back());
+    m_redoEntries.push_back(std::move(m_undoEntries.back()));
+    m_undoEntries.pop_back();
+    return true;
+}
+
+bool SculptHistory::Redo(Heightmap& heightmap) {
+    if (m_redoEntries.empty()) {
+        return false;
+    }
+
+    ApplyEntry(heightmap, m_redoEntries.back());
+    m_undoEntries.push_back(std::move(m_redoEntries.back()));
+    m_redoEntries.pop_back();
+    return true;
+}
+
+void SculptHistory::Clear() {
+    m_undoEntries.clear();
+    m_redoEntries.clear();
+    m_strokeTiles.clear();
+    m_memoryUsage = 0;
+}
+
+void SculptHistory::SetMemoryBudget(size_t memoryBudget) {
+    m_memoryBudget = memoryBudget;
+    EvictOldest();
+}
+
+//drop the oldest strokes until the history fits in the budget. redo entries only go once every undo entry is gone
+void SculptHistory::EvictOldest() {
+    while (m_memoryUsage > m_memoryBudget && !m_undoEntries.empty()) {
+        m_memoryUsage -= m_undoEntries.front().byteSize;
+        m_undoEntries.pop_front();
+    }
+    while (m_memoryUsage > m_memoryBudget && !m_redoEntries.empty()) {
+        m_memoryUsage -= m_redoEntries.front().byteSize;
+        m_redoEntries.erase(m_redoEntries.begin());
+    }
+}
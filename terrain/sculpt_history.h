@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "heightmap.h"
+
+// Undo/redo for sculpt strokes. A stroke only keeps the heightmap tiles it changed, stored as the XOR of the heights
+// before and after the stroke. Applying the same XOR again swaps between the two states, so undo and redo share one
+// code path. The XOR is zero wherever nothing changed and mostly zero in the sign and exponent bits where it did, so
+// each tile is split into byte planes and compressed with zero run length encoding.
+class SculptHistory {
+public:
+	static const int TILE_SIZE = 64; // texels per side of a tile
+
+	explicit SculptHistory(size_t memoryBudget = 64 * 1024 * 1024);
+
+	// called before every brush application of a stroke with the texels it may change. tiles are copied the first time
+	// a stroke touches them
+	void RecordRegion(const Heightmap& heightmap, const HeightmapRegion& region);
+	// compresses the changes of the current stroke into a new undo entry and drops the redo entries
+	void EndStroke(const Heightmap& heightmap);
+
+	bool Undo(Heightmap& heightmap);
+	bool Redo(Heightmap& heightmap);
+	// for when the heightmap is replaced rather than sculpted
+	void Clear();
+
+	bool IsRecording() const { return !m_strokeTiles.empty(); }
+	bool CanUndo() const { return !m_undoEntries.empty(); }
+	bool CanRedo() const { return !m_redoEntries.empty(); }
+	int GetUndoCount() const { return int(m_undoEntries.size()); }
+	int GetRedoCount() const { return int(m_redoEntries.size()); }
+	size_t GetMemoryUsage() const { return m_memoryUsage; }
+	size_t GetMemoryBudget() const { return m_memoryBudget; }
+	void SetMemoryBudget(size_t memoryBudget);
+
+private:
+	struct CompressedTile {
+		int tileX;
+		int tileZ;
+		std::vector<uint8_t> data;
+	};
+
+	struct Entry {
+		std::vector<CompressedTile> tiles;
+		size_t byteSize = 0;
+	};
+
+	void GetTileBounds(const Heightmap& heightmap, int tileX, int tileZ, HeightmapRegion& bounds) const;
+	void ApplyEntry(Heightmap& heightmap, const Entry& entry) const;
+	void EvictOldest();
+
+	size_t m_memoryBudget;
+	size_t m_memoryUsage = 0;
+	std::deque<Entry> m_undoEntries; // oldest first
+	std::vector<Entry> m_redoEntries; // most recently undone last
+	std::unordered_map<int, std::vector<float>> m_strokeTiles; // heights before the stroke, by tile index
+};
@@ -0,0 +1,321 @@
+#include <cfloat>
+#include <cmath>
+#include <vector>
+#include <FastNoise/FastNoise.h>
+#include "sculptor.hpp"
+#include "../util/thread_pool.h"
+
+BrushFalloff::BrushFalloff(int brushType, float radius) {
+    //small brushes cover few texels, filling a full table would cost more than the footprint
+    m_tableSize = glm::clamp(int(std::ceil(radius * radius)), MIN_TABLE_SIZE, MAX_TABLE_SIZE);
+    switch (brushType) {
+    case 1: FillTable<Sculptor::LinearFalloff>(radius); break;
+    case 2: FillTable<Sculptor::LinearSmoothstep>(radius); break;
+    case 3: FillTable<Sculptor::Polynomial>(radius); break;
+    case 4: FillTable<Sculptor::Logarithmic>(radius); break;
+    default: FillTable<Sculptor::Step>(radius); break;
+    }
+}
+
+//entry i holds the weight at the squared distance i / m_indexScale
+template<float (*Falloff)(float, float, float)>
+void BrushFalloff::FillTable(float radius) {
+    float minRadius = radius / 3;
+    float squaredRadius = std::max(radius * radius, FLT_MIN);
+    m_indexScale = m_tableSize / squaredRadius;
+    for (int i = 0; i < m_tableSize; i++) {
+        m_table[i] = Falloff(std::sqrt(i / m_indexScale), radius, minRadius);
+    }
+    //the weight at the radius itself, repeated so the last entry interpolates with a neighbour
+    m_table[m_tableSize] = Falloff(radius, radius, minRadius);
+    m_table[m_tableSize + 1] = m_table[m_tableSize];
+}
+
+//world coords of a texel use the same mapping as the brush region, so the distance along the row grows by a fixed step
+void BrushFalloff::GetRowWeights(const Heightmap& heightmap, float pointX, float pointZ, int z, int startX, int count, float* weights) const {
+    float heightmapSize = heightmap.GetSize();
+    int heightmapResolution = heightmap.GetResolution();
+    float texelSpacing = 2.f * heightmapSize / heightmapResolution;
+    float distanceZ = ((float(z) / heightmapResolution) * 2.f - 1.f) * heightmapSize - pointZ;
+    float startDistanceX = ((float(startX) / heightmapResolution) * 2.f - 1.f) * heightmapSize - pointX;
+    float squaredDistanceZ = distanceZ * distanceZ;
+    float maxIndex = float(m_tableSize);
+
+    //interpolated between neighbouring entries, the curves are steep near the edge. texels outside the radius are masked
+    //to 0 with a multiply rather than skipped
+    for (int i = 0; i < count; i++) {
+        float distanceX = startDistanceX + i * texelSpacing;
+        float index = (distanceX * distanceX + squaredDistanceZ) * m_indexScale;
+        float inside = float(index <= maxIndex);
+        index = std::min(index, maxIndex);
+        int entry = int(index);
+        float fraction = index - entry;
+        weights[i] = (m_table[entry] + (m_table[entry + 1] - m_table[entry]) * fraction) * inside;
+    }
+}
+
+//the footprint is clipped to the map once and raised row by row, then written back in one go like the other tools
+void Sculptor::Sculpt(std::shared_ptr<Heightmap> heightmap, float pointX, float pointZ, float radius, float strength, int brushType) {
+    HeightmapRegion region = GetBrushRegion(*heightmap, pointX, pointZ, radius);
+    if (region.IsEmpty()) {
+        return;
+    }
+
+    BrushFalloff falloff(brushType, radius);
+    std::vector<float> sculptedHeights(size_t(region.GetWidth()) * region.GetHeight());
+    HeightFieldView<float> sculpted = { sculptedHeights.data(), region.GetWidth(), region.GetHeight(), region.GetWidth() };
+    HeightFieldView<const float> heights = heightmap->GetHeightField().GetView(region);
+
+    util::ThreadPool::Get().ParallelFor(0, sculpted.height, 16, [&](int rowBegin, int rowEnd) {
+        std::vector<float> weights(sculpted.width);
+        for (int z = rowBegin; z < rowEnd; z++) {
+            falloff.GetRowWeights(*heightmap, pointX, pointZ, region.minZ + z, region.minX, sculpted.width, weights.data());
+            const float* before = heights.GetRow(z);
+            float* row = sculpted.GetRow(z);
+            for (int x = 0; x < sculpted.width; x++) {
+                row[x] = before[x] + strength * weights[x];
+            }
+        }
+    });
+
+    heightmap->SetHeights(HeightFieldView<const float>{ sculptedHeights.data(), sculpted.width, sculpted.height, sculpted.width }, region);
+}
+
+//box blur of the source, written for the part of it that out covers, starting at offsetX, offsetZ. both passes keep a
+//running sum, so the cost doesn't depend on the blur radius. the window is cut off where the source ends
+static void BoxBlur(const HeightFieldView<float>& source, int blurRadius, int offsetX, int offsetZ, const HeightFieldView<float>& out) {
+    std::vector<float> horizontal(size_t(source.width) * source.height);
+    HeightFieldView<float> rows = { horizontal.data(), source.width, source.height, source.width };
+
+    util::ThreadPool::Get().ParallelFor(0, source.height, 16, [&](int rowBegin, int rowEnd) {
+        for (int z = rowBegin; z < rowEnd; z++) {
+            const float* row = source.GetRow(z);
+            float* blurred = rows.GetRow(z);
+            float sum = 0.f;
+            int count = std::min(blurRadius, source.width - 1) + 1;
+            for (int x = 0; x < count; x++) {
+                sum += row[x];
+            }
+            for (int x = 0; x < source.width; x++) {
+                blurred[x] = sum / count;
+                if (x + blurRadius + 1 < source.width) {
+                    sum += row[x + blurRadius + 1];
+                    count++;
+                }
+                if (x - blurRadius >= 0) {
+                    sum -= row[x - blurRadius];
+                    count--;
+                }
+            }
+        }
+    });
+
+    //the vertical pass slides a whole row of sums down a band of columns, so it reads rows rather than columns
+    const int columnsPerBand = 64;
+    util::ThreadPool::Get().ParallelFor(0, out.width, columnsPerBand, [&](int columnBegin, int columnEnd) {
+        int width = columnEnd - columnBegin;
+        std::vector<float> sums(width, 0.f);
+        int firstRow = std::max(offsetZ - blurRadius, 0);
+        int lastRow = std::min(offsetZ + blurRadius, source.height - 1);
+        for (int z = firstRow; z <= lastRow; z++) {
+            const float* row = rows.GetRow(z) + offsetX + columnBegin;
+            for (int i = 0; i < width; i++) {
+                sums[i] += row[i];
+            }
+        }
+        int count = lastRow - firstRow + 1;
+
+        for (int z = 0; z < out.height; z++) {
+            float* blurred = out.GetRow(z) + columnBegin;
+            float scale = 1.f / count;
+            for (int i = 0; i < width; i++) {
+                blurred[i] = sums[i] * scale;
+            }
+            int addedRow = offsetZ + z + blurRadius + 1;
+            int removedRow = offsetZ + z - blurRadius;
+            if (addedRow < source.height) {
+                const float* row = rows.GetRow(addedRow) + offsetX + columnBegin;
+                for (int i = 0; i < width; i++) {
+                    sums[i] += row[i];
+                }
+                count++;
+            }
+            if (removedRow >= 0) {
+                const float* row = rows.GetRow(removedRow) + offsetX + columnBegin;
+                for (int i = 0; i < width; i++) {
+                    sums[i] -= row[i];
+                }
+                count--;
+            }
+        }
+    });
+}
+
+//one step of thermal erosion, like ErosionSimulator's, over the footprint source and out cover. material only moves
+//between two texels of the footprint, scaled by the smaller of their weights, so whatever one texel loses another one
+//gains and the texels around the footprint are left alone
+static void RelaxSlopes(const HeightFieldView<float>& source, float talusAngle, float texelSpacing, const HeightFieldView<float>& weights,
+    const HeightFieldView<float>& out) {
+    static const int NEIGHBOUR_COUNT = 8;
+    static const int neighbourX[NEIGHBOUR_COUNT] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+    static const int neighbourZ[NEIGHBOUR_COUNT] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+    float talus[NEIGHBOUR_COUNT];
+    for (int n = 0; n < NEIGHBOUR_COUNT; n++) {
+        float distance = std::sqrt(float(neighbourX[n] * neighbourX[n] + neighbourZ[n] * neighbourZ[n])) * texelSpacing;
+        talus[n] = std::tan(glm::radians(talusAngle)) * distance;
+    }
+    auto IsInside = [&](int x, int z) {
+        return x >= 0 && x < source.width && z >= 0 && z < source.height;
+    };
+
+    //half the largest excess leaves a texel, shared by how far each neighbour is below the slope
+    std::vector<float> outflowScales(size_t(source.width) * source.height);
+    HeightFieldView<float> scales = { outflowScales.data(), source.width, source.height, source.width };
+    util::ThreadPool::Get().ParallelFor(0, source.height, 16, [&](int rowBegin, int rowEnd) {
+        for (int z = rowBegin; z < rowEnd; z++) {
+            for (int x = 0; x < source.width; x++) {
+                float height = source.At(x, z);
+                float excessSum = 0.f;
+                float maxExcess = 0.f;
+                for (int n = 0; n < NEIGHBOUR_COUNT; n++) {
+                    int sampleX = x + neighbourX[n];
+                    int sampleZ = z + neighbourZ[n];
+                    if (!IsInside(sampleX, sampleZ)) {
+                        continue;
+                    }
+                    float excess = std::max(height - source.At(sampleX, sampleZ) - talus[n], 0.f);
+                    excessSum += excess;
+                    maxExcess = std::max(maxExcess, excess);
+                }
+                scales.At(x, z) = excessSum > 0.f ? maxExcess * 0.5f / excessSum : 0.f;
+            }
+        }
+    });
+
+    util::ThreadPool::Get().ParallelFor(0, out.height, 16, [&](int rowBegin, int rowEnd) {
+        for (int z = rowBegin; z < rowEnd; z++) {
+            for (int x = 0; x < out.width; x++) {
+                float height = source.At(x, z);
+                float change = 0.f;
+                for (int n = 0; n < NEIGHBOUR_COUNT; n++) {
+                    int sampleX = x + neighbourX[n];
+                    int sampleZ = z + neighbourZ[n];
+                    if (!IsInside(sampleX, sampleZ)) {
+                        continue;
+                    }
+                    float neighbour = source.At(sampleX, sampleZ);
+                    float weight = std::min(weights.At(x, z), weights.At(sampleX, sampleZ));
+                    change -= std::max(height - neighbour - talus[n], 0.f) * scales.At(x, z) * weight;
+                    change += std::max(neighbour - height - talus[n], 0.f) * scales.At(sampleX, sampleZ) * weight;
+                }
+                out.At(x, z) = height + change;
+            }
+        }
+    });
+}
+
+//every tool works out a target height per texel from the snapshot, then the texels move towards it by the amount and
+//the brush falloff. erode applies the amount and the falloff to the material it moves instead
+void Sculptor::ApplyTool(Heightmap& heightmap, BrushTool tool, float pointX, float pointZ, float radius, float amount, int brushType,
+    const BrushToolSettings& settings) {
+    HeightmapRegion region = GetBrushRegion(heightmap, pointX, pointZ, radius);
+    if (region.IsEmpty() || tool == BrushTool::Raise) {
+        return;
+    }
+
+    //the blur reads around the footprint
+    int heightmapResolution = heightmap.GetResolution();
+    int halo = 0;
+    if (tool == BrushTool::Smooth) {
+        halo = std::max(settings.smoothRadius, 1);
+    }
+    HeightmapRegion sourceRegion;
+    sourceRegion.Include(std::max(region.minX - halo, 0), std::max(region.minZ - halo, 0));
+    sourceRegion.Include(std::min(region.maxX + halo, heightmapResolution - 1), std::min(region.maxZ + halo, heightmapResolution - 1));
+    int offsetX = region.minX - sourceRegion.minX;
+    int offsetZ = region.minZ - sourceRegion.minZ;
+
+    std::vector<float> snapshot(size_t(sourceRegion.GetWidth()) * sourceRegion.GetHeight());
+    HeightFieldView<float> source = { snapshot.data(), sourceRegion.GetWidth(), sourceRegion.GetHeight(), sourceRegion.GetWidth() };
+    HeightFieldView<const float> heights = heightmap.GetHeightField().GetView(sourceRegion);
+    for (int z = 0; z < source.height; z++) {
+        std::copy(heights.GetRow(z), heights.GetRow(z) + source.width, source.GetRow(z));
+    }
+
+    std::vector<float> targetHeights(size_t(region.GetWidth()) * region.GetHeight());
+    HeightFieldView<float> targets = { targetHeights.data(), region.GetWidth(), region.GetHeight(), region.GetWidth() };
+    float heightmapSize = heightmap.GetSize();
+    BrushFalloff falloff(brushType, radius);
+
+    switch (tool) {
+    case BrushTool::Smooth:
+        BoxBlur(source, halo, offsetX, offsetZ, targets);
+        break;
+    case BrushTool::Erode: {
+        //the falloff scales the exchanges instead of the heights, blending the heights would not keep the material
+        std::vector<float> flowWeights(targetHeights.size());
+        HeightFieldView<float> weights = { flowWeights.data(), targets.width, targets.height, targets.width };
+        for (int z = 0; z < weights.height; z++) {
+            float* row = weights.GetRow(z);
+            falloff.GetRowWeights(heightmap, pointX, pointZ, region.minZ + z, region.minX, weights.width, row);
+            for (int x = 0; x < weights.width; x++) {
+                row[x] = glm::clamp(row[x] * amount, 0.f, 1.f);
+            }
+        }
+        RelaxSlopes(source, settings.talusAngle, heightmapSize * 2.f / heightmapResolution, weights, targets);
+        heightmap.SetHeights(HeightFieldView<const float>{ targetHeights.data(), targets.width, targets.height, targets.width }, region);
+        return;
+    }
+    case BrushTool::Flatten: {
+        //towards the height under the brush centre when the application started
+        int gridX = glm::clamp(int((pointX / heightmapSize + 1.f) / 2.f * heightmapResolution), 0, heightmapResolution - 1);
+        int gridZ = glm::clamp(int((pointZ / heightmapSize + 1.f) / 2.f * heightmapResolution), 0, heightmapResolution - 1);
+        std::fill(targetHeights.begin(), targetHeights.end(), heightmap.GetHeight(gridX, gridZ));
+        break;
+    }
+    case BrushTool::Noise: {
+        FastNoise noise;
+        noise.SetNoiseType(FastNoise::Simplex);
+        noise.SetFrequency(settings.noiseFrequency);
+        util::ThreadPool::Get().ParallelFor(0, targets.height, 16, [&](int rowBegin, int rowEnd) {
+            for (int z = rowBegin; z < rowEnd; z++) {
+                float worldZ = ((float(region.minZ + z) / heightmapResolution) * 2.f - 1.f) * heightmapSize;
+                for (int x = 0; x < targets.width; x++) {
+                    float worldX = ((float(region.minX + x) / heightmapResolution) * 2.f - 1.f) * heightmapSize;
+                    targets.At(x, z) = source.At(x + offsetX, z + offsetZ) + noise.GetNoise(worldX, worldZ) * settings.noiseAmplitude;
+                }
+            }
+        });
+        break;
+    }
+    case BrushTool::Terrace: {
+        //heights snap to multiples of the terrace height, the steps get a smooth edge that narrows with the sharpness
+        float edge = std::max(1.f - settings.terraceSharpness, 0.01f);
+        float terraceHeight = std::max(settings.terraceHeight, 0.01f);
+        for (int z = 0; z < targets.height; z++) {
+            for (int x = 0; x < targets.width; x++) {
+                float steps = source.At(x + offsetX, z + offsetZ) / terraceHeight;
+                float step = std::floor(steps);
+                targets.At(x, z) = (step + glm::smoothstep(0.5f - edge * 0.5f, 0.5f + edge * 0.5f, steps - step)) * terraceHeight;
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    util::ThreadPool::Get().ParallelFor(0, targets.height, 16, [&](int rowBegin, int rowEnd) {
+        std::vector<float> weights(targets.width);
+        for (int z = rowBegin; z < rowEnd; z++) {
+            falloff.GetRowWeights(heightmap, pointX, pointZ, region.minZ + z, region.minX, targets.width, weights.data());
+            const float* before = source.GetRow(z + offsetZ) + offsetX;
+            float* row = targets.GetRow(z);
+            for (int x = 0; x < targets.width; x++) {
+                row[x] = before[x] + (row[x] - before[x]) * amount * weights[x];
+            }
+        }
+    });
+
+    heightmap.SetHeights(HeightFieldView<const float>{ targetHeights.data(), targets.width, targets.height, targets.width }, region);
+}
@@ -1,64 +1,57 @@
+#pragma once
 #include "terrain.h"
 
+// Brushes besides raising and lowering. They all work on the brush footprint at once
+enum class BrushTool {
+    Raise,
+    Smooth,
+    Flatten,
+    Noise,
+    Terrace,
+    Erode
+};
+
+struct BrushToolSettings {
+    int smoothRadius = 4; // texels of the box blur
+    float noiseFrequency = 0.05f; // per world unit
+    float noiseAmplitude = 5.f;
+    float terraceHeight = 10.f;
+    float terraceSharpness = 0.8f; // [0, 1], 1 gives hard steps
+    float talusAngle = 30.f; // degrees, slopes the erode brush leaves alone
+};
+
 struct Sculptor {
 
-    static void Sculpt(std::shared_ptr<Heightmap> heightmap, float pointX, float pointZ, float radius, float strength, int brushType) {
-        float minRadius = radius/3;
-        float heightmapSize = heightmap->GetSize();
-        int heightmapResolution = heightmap->GetResolution();
-
-        float normalizedX = (pointX / heightmapSize + 1.f); //[0, 1]
-        float normalizedZ = (pointZ / heightmapSize + 1.f);
-
-        int gridX = int(normalizedX/2.f * heightmapResolution);
-        int gridZ = int(normalizedZ/2.f * heightmapResolution);
-
-        //calculate ranges to loop iterate through based on radius
-        int startX = gridX - radius;
-        int endX = gridX + radius;
-        int startZ = gridZ - radius;
-        int endZ = gridZ + radius;
-
-        //loop through ranges
-        for (int z = startZ; z <= endZ; z++) {
-            for (int x = startX; x <= endX; x++) {
-                if (x < 0 || x >= heightmapResolution ||
-                    z < 0 || z >= heightmapResolution) {
-                    continue;
-                }
-
-                //revert to world coords
-                float worldX = ((float(x) / heightmapResolution) * 2.f - 1.f) * heightmapSize;
-                float worldZ = ((float(z) / heightmapResolution) * 2.f - 1.f) * heightmapSize;
-
-                //distance between center and current point
-                float distance = std::sqrt((worldX - pointX) * (worldX - pointX) + (worldZ - pointZ) * (worldZ - pointZ));
-
-                if (distance > radius) 
-                    continue;
-
-                float intensity = 1.f;
-                if (brushType == 0) {
-                    intensity = Step(distance, radius, minRadius);
-                }
-                if (brushType == 1) {
-                    intensity = LinearFalloff(distance, radius, minRadius);
-                }
-                if (brushType == 2) {
-                    intensity = LinearSmoothstep(distance, radius, minRadius);
-                }
-                if (brushType == 3) {
-                    intensity = Polynomial(distance, radius, minRadius);
-                }
-                if (brushType == 4) {
-                    intensity = Logarithmic(distance, radius, minRadius);
-                }
-
-                heightmap->SetHeight(x, z, heightmap->GetHeight(x, z) + strength * intensity);
-            }
+    // texels a brush application at the point may change, clipped to the heightmap
+    static HeightmapRegion GetBrushRegion(const Heightmap& heightmap, float pointX, float pointZ, float radius) {
+        float heightmapSize = heightmap.GetSize();
+        int heightmapResolution = heightmap.GetResolution();
+
+        int gridX = int((pointX / heightmapSize + 1.f) / 2.f * heightmapResolution);
+        int gridZ = int((pointZ / heightmapSize + 1.f) / 2.f * heightmapResolution);
+
+        HeightmapRegion region;
+        int startX = std::max(int(gridX - radius), 0);
+        int startZ = std::max(int(gridZ - radius), 0);
+        int endX = std::min(int(gridX + radius), heightmapResolution - 1);
+        int endZ = std::min(int(gridZ + radius), heightmapResolution - 1);
+        if (startX <= endX && startZ <= endZ) {
+            region.Include(startX, startZ);
+            region.Include(endX, endZ);
         }
+        return region;
     }
 
+    // raises the footprint by strength times the brush falloff, or lowers it for a negative strength
+    static void Sculpt(std::shared_ptr<Heightmap> heightmap, float pointX, float pointZ, float radius, float strength, int brushType);
+
+    // applies a tool other than Raise to the footprint. every texel's new height only depends on the heights before the
+    // application, which are copied out first, so the result doesn't depend on the order texels are visited in.
+    // amount is the share of the way to the tool's target height, [0, 1], before the brush falloff. for Noise it scales
+    // the noise amplitude and may be negative
+    static void ApplyTool(Heightmap& heightmap, BrushTool tool, float pointX, float pointZ, float radius, float amount, int brushType,
+        const BrushToolSettings& settings);
+
     static float Step(float distance, float maxRadius, float minRadius) {
         return (distance <= maxRadius) ? 1.f : 0;
     }
@@ -82,4 +75,26 @@ struct Sculptor {
         float linear = glm::clamp(1.f - (distance - minRadius) / (maxRadius - minRadius), 0.f, 1.f);
         return glm::log(1.f + glm::pow(linear, .75f) * 9.f) / glm::log(10.f); //gradual effect 
     }
-};
\ No newline at end of file
+};
+
+// The falloff of a brush baked into a table for one application, so the texels of the footprint only look up their
+// weight instead of evaluating the curve. The table is indexed by the squared distance from the centre, which saves the
+// square root per texel, and texels outside the brush are masked out without a branch.
+class BrushFalloff {
+public:
+    static const int MIN_TABLE_SIZE = 64;
+    static const int MAX_TABLE_SIZE = 1024;
+
+    BrushFalloff(int brushType, float radius);
+
+    // weights along part of a heightmap row, without a branch per texel
+    void GetRowWeights(const Heightmap& heightmap, float pointX, float pointZ, int z, int startX, int count, float* weights) const;
+
+private:
+    template<float (*Falloff)(float, float, float)>
+    void FillTable(float radius);
+
+    int m_tableSize;
+    float m_indexScale; // table entries per squared world unit
+    float m_table[MAX_TABLE_SIZE + 2];
+};
@@ -1,29 +1,96 @@
+#include <algorithm>
 #include "terrain.h"
 
-Terrain::Terrain(Model model, std::shared_ptr<Heightmap> heightmap, Shadowmap shadowmap, std::vector<GLuint> textureIDs, std::vector<float> textureCoords, std::vector<float> vertices, std::vector<int> indices)
-    : m_textureIDs(textureIDs), m_model(model), m_shadowmap(shadowmap), m_heightmap(heightmap),
-      m_textureCoords(textureCoords), m_vertices(vertices), m_indices(indices){
-
+//revisions are unique across terrains, so a regenerated terrain never matches a revision seen before
+static int nextTerrainRevision = 0;
+
+//the texture is expected to hold the current heights, everything else is built from the whole map here, so changes
+//made to the heightmap before don't have to be seen again
+Terrain::Terrain(Model patchModel, std::shared_ptr<Heightmap> heightmap, HeightmapTexture heightmapTexture, Shadowmap shadowmap, std::vector<GLuint> textureIDs, TerrainQuadtree quadtree)
+    : m_textureIDs(textureIDs), m_model(patchModel), m_shadowmap(shadowmap), m_heightmap(heightmap), m_heightmapTexture(heightmapTexture), m_quadtree(quadtree){
+
+    HeightmapRegion wholeMap;
+    wholeMap.Include(0, 0);
+    wholeMap.Include(m_heightmap->GetResolution() - 1, m_heightmap->GetResolution() - 1);
+    m_quadtree.UpdateBounds(*m_heightmap, wholeMap);
+    m_heightPyramid = HeightPyramid(*m_heightmap);
+    m_heightmap->ClearDirtyRegion();
+    m_revision = nextTerrainRevision++;
 }
 
 
 const float Terrain::GetHeightFromWorld(int pointX, int pointZ) const {
+    return m_heightmap->GetHeightFromWorld(pointX, pointZ);
+}
+
+//brings everything derived from the heights up to date with the texels that changed since the last update
+void Terrain::Update(){
+    const HeightmapRegion& changedRegion = m_heightmap->GetDirtyRegion();
+    if (changedRegion.IsEmpty()) {
+        return;
+    }
+
+    //texels set since the last update only widened the range
+    m_heightmap->UpdateHeightRange();
+    m_quadtree.UpdateBounds(*m_heightmap, changedRegion);
+    m_heightPyramid.Update(*m_heightmap, changedRegion);
+    m_heightmapTexture.Update(m_heightmap->GetHeightField(), changedRegion);
+    m_heightmap->ClearDirtyRegion();
+    m_revision = nextTerrainRevision++;
+}
 
-    float heightmapSize = m_heightmap->GetSize();
-    int heightmapResolution = m_heightmap->GetResolution();
+void Terrain::BeginReplacement(std::unique_ptr<GeneratedTerrain> generated, DataFactory dataFactory) {
+    int resolution = int(generated->heightmap->GetResolution());
+    //the back texture is kept between replacements and only re-specified when the resolution changes, so a stream of
+    //previews doesn't create GL objects
+    if (m_backHeightmapTexture.GetTextureID() == 0) {
+        m_backHeightmapTexture = HeightmapTexture(resolution, dataFactory);
+    }
+    else if (m_backHeightmapTexture.GetResolution() != resolution) {
+        m_backHeightmapTexture.Allocate(resolution);
+    }
+    m_replacement = std::move(generated);
+    m_replacementUploadedRows = 0;
+}
 
-    // terrain coords go from -heightmapSize/2 to +heightmapSize/2. normalize to [0,1]
-    float normalizedX = (pointX / heightmapSize + 1.f) * 0.5f; //[0, 1]
-    float normalizedZ = (pointZ / heightmapSize + 1.f) * 0.5f;
+bool Terrain::UpdateReplacement() {
+    if (!m_replacement) {
+        return false;
+    }
 
-    int gridX = int(normalizedX * heightmapResolution);
-    int gridZ = int(normalizedZ * heightmapResolution);
+    const HeightField& heights = m_replacement->heightmap->GetHeightField();
+    int resolution = heights.GetResolution();
+    int rowsPerFrame = std::max(1, int(REPLACEMENT_UPLOAD_BUDGET / (size_t(resolution) * sizeof(float))));
+
+    HeightmapRegion rows;
+    rows.Include(0, m_replacementUploadedRows);
+    m_replacementUploadedRows = std::min(m_replacementUploadedRows + rowsPerFrame, resolution);
+    rows.Include(resolution - 1, m_replacementUploadedRows - 1);
+    m_backHeightmapTexture.Update(heights, rows);
+    if (m_replacementUploadedRows < resolution) {
+        return false;
+    }
 
-    return m_heightmap->GetHeight(gridX, gridZ);
+    //every texel is on the gpu, so the replacement becomes the terrain in one go and the old texture becomes the back
+    //buffer for the next replacement
+    std::swap(m_heightmapTexture, m_backHeightmapTexture);
+    if (resolution != m_shadowmap.shadowMapResolution) {
+        m_shadowmap.Resize(resolution);
+    }
+    m_heightmap = m_replacement->heightmap;
+    m_quadtree = std::move(m_replacement->quadtree);
+    m_heightPyramid = std::move(m_replacement->heightPyramid);
+    m_replacement.reset();
+    m_revision = nextTerrainRevision++;
+    return true;
 }
 
-void Terrain::Update(){
-	m_heightmap->Update();
+TerrainSelection Terrain::SelectLod(const Frustum& frustum, glm::vec3 cameraPosition, float lodDistance) const {
+    return m_quadtree.Select(frustum, cameraPosition, lodDistance);
+}
+
+TerrainSelection Terrain::SelectLevel(const Frustum& frustum, int level) const {
+    return m_quadtree.SelectLevel(frustum, level);
 }
 
 void Terrain::UpdateTexture(int index, GLuint newTextureID){
@@ -38,69 +105,57 @@ void Terrain::UpdateSize(float size){
 
 //size is used to scale the terrain, distance between each 
 Terrain TerrainFactory::GenerateTerrain(DataFactory dataFactory, float size, int resolution, std::vector<GLuint> textureIDs, float noiseSeed){
-    std::vector<float> vertices;
-    std::vector<float> textureCoords;
-    std::vector<int> indices;
-
-    //calculate the step size for texture coordinate
-    float step = 1.f / (resolution - 1); //-1 because loop goes up to resolution-1
-
-    //generate vertices and texture coordinates
-    for (int i = 0; i < resolution; i++) {
-        float u = i * step; //normalize to be between [0,1]
-        float x = u * size * 2.f - size;
-
-        for (int j = 0; j < resolution; j++) {
-            float v = j * step;
-            float z = v * size * 2.f - size;
+    std::shared_ptr<Heightmap> heightmap = std::make_shared<Heightmap>(size, resolution, noiseSeed);
+    return GenerateTerrain(dataFactory, heightmap, textureIDs);
+}
 
-            //store vertex position
-            vertices.push_back(x);  
-            vertices.push_back(0.f);  
-            vertices.push_back(z);  
+//builds a terrain around heights that already exist, e.g. loaded from a file
+Terrain TerrainFactory::GenerateTerrain(DataFactory dataFactory, std::shared_ptr<Heightmap> heightmap, std::vector<GLuint> textureIDs){
+    //the terrain is drawn as patches of one small grid mesh, placed and displaced by the vertex shader, so no mesh the size
+    //of the map is built
+    int resolution = int(heightmap->GetResolution());
+    Model patchModel = GeneratePatchModel(dataFactory);
+    HeightmapTexture heightmapTexture = HeightmapTexture(heightmap->GetHeightField(), dataFactory);
+    Shadowmap shadowmap = Shadowmap(resolution, dataFactory);
+    return Terrain(patchModel, heightmap, heightmapTexture, shadowmap, textureIDs, TerrainQuadtree(heightmap->GetSize(), resolution));
+}
 
-            //store texture coordinates
-            textureCoords.push_back(u); 
-            textureCoords.push_back(v); 
+//builds the PATCH_QUADS x PATCH_QUADS grid every quadtree node is drawn with. positions are in patch quads and the
+//triangles are stored one quadrant after another, so a quadrant can be drawn on its own
+Model TerrainFactory::GeneratePatchModel(DataFactory& dataFactory){
+    const int patchQuads = TerrainQuadtree::PATCH_QUADS;
+    const int patchResolution = patchQuads + 1;
+    const int halfQuads = patchQuads / 2;
+
+    std::vector<float> interleavedVertices; //[x,y,z,u,v] <- vertex buffer data layout for each vertex
+    for (int i = 0; i < patchResolution; i++) {
+        for (int j = 0; j < patchResolution; j++) {
+            float u = float(i) / patchQuads;
+            float v = float(j) / patchQuads;
+            interleavedVertices.insert(interleavedVertices.end(), { float(i), 0.f, float(j), u, v });
+        }
+    }
 
-            //insert here
-            if (i < resolution - 1 && j < resolution - 1) {
-                int topLeft = i * resolution + j;
-                int topRight = topLeft + 1;
-                int bottomLeft = (i + 1) * resolution + j;
-                int bottomRight = bottomLeft + 1;
+    std::vector<GLushort> indices;
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        int startI = (quadrant & 1) * halfQuads;
+        int startJ = (quadrant >> 1) * halfQuads;
 
+        for (int i = startI; i < startI + halfQuads; i++) {
+            for (int j = startJ; j < startJ + halfQuads; j++) {
+                GLushort topLeft = i * patchResolution + j;
+                GLushort topRight = topLeft + 1;
+                GLushort bottomLeft = (i + 1) * patchResolution + j;
+                GLushort bottomRight = bottomLeft + 1;
 
                 //first triangle (topleft)
-                indices.push_back(topLeft);
-                indices.push_back(bottomLeft);
-                indices.push_back(topRight);
+                indices.insert(indices.end(), { topLeft, bottomLeft, topRight });
 
                 //second triangle (bottom right)
-                indices.push_back(topRight);
-                indices.push_back(bottomLeft);
-                indices.push_back(bottomRight);
+                indices.insert(indices.end(), { topRight, bottomLeft, bottomRight });
             }
         }
     }
 
-    //reorder vertices and textures based on indices. Need to format it like such for VBO:
-    //[x,y,z,u,v] <- vertex buffer data layout for each index
-    std::vector<float> verticesOut;
-    std::vector<float> texturesOut;
-    for (int index : indices) {
-        //grav each vertex and texture data based on the index
-        verticesOut.push_back(vertices[index * 3 + 0]); //x
-        verticesOut.push_back(vertices[index * 3 + 1]); //y
-        verticesOut.push_back(vertices[index * 3 + 2]); //z
-        texturesOut.push_back(textureCoords[index * 2 + 0]); //u
-        texturesOut.push_back(textureCoords[index * 2 + 1]); //v
-    }
-
-    //create model with vertex and texture data
-    Model terrainModelData = dataFactory.CreateModel(verticesOut.data(), texturesOut.data(), verticesOut.size() / 3);
-    Model shadowmapModelData = dataFactory.CreateModelWithoutTextureCoords(verticesOut.data(), verticesOut.size() / 3);
-    std::shared_ptr<Heightmap> heightmap = std::make_shared<Heightmap>(size, resolution, noiseSeed, dataFactory);
-    Shadowmap shadowmap = Shadowmap(resolution, dataFactory);
-    return Terrain(terrainModelData, heightmap, shadowmap, textureIDs, textureCoords, vertices, indices);
+    return dataFactory.CreateIndexedModel(interleavedVertices.data(), patchResolution * patchResolution, indices.data(), indices.size(), GL_UNSIGNED_SHORT);
 }
@@ -1,15 +1,26 @@
 #pragma once
 #include <vector>
 #include "heightmap.h"
+#include "heightmap_texture.h"
+#include "terrain_quadtree.h"
+#include "height_pyramid.h"
+#include "terrain_generator.h"
 #include "../engine/data_factory.h"
 #include "../effects/shadowmap.hpp"
 
 class Terrain {
 public:
-	Terrain(Model model, std::shared_ptr<Heightmap> heightmap, Shadowmap shadowmap, std::vector<GLuint> textureIDs, std::vector<float> textureCoords, std::vector<float> vertices, std::vector<int> indices);
+	Terrain(Model patchModel, std::shared_ptr<Heightmap> heightmap, HeightmapTexture heightmapTexture, Shadowmap shadowmap, std::vector<GLuint> textureIDs, TerrainQuadtree quadtree);
 	Terrain() = default;
 
 	void Update();
+	// starts swapping in a terrain generated in the background. its heights are uploaded into a second texture a slice
+	// per frame by UpdateReplacement while the current terrain keeps rendering. a newer replacement restarts the upload.
+	// replacements may change the resolution, progressive previews swap in several in a row
+	void BeginReplacement(std::unique_ptr<GeneratedTerrain> generated, DataFactory dataFactory);
+	// uploads the next slice of the pending replacement and swaps it in after the last one. true on the frame it swapped
+	bool UpdateReplacement();
+	bool IsReplacing() const { return m_replacement != nullptr; }
 	void UpdateTexture(int index, GLuint newTextureID);
 	void UpdateSize(float size);
 	const float GetHeightFromWorld(int x, int z) const;
@@ -17,20 +28,30 @@ public:
 	const float GetMaxHeight() { return m_heightmap->GetMaxHeight(); }
 	const Model GetModel() const { return m_model; }
 	std::shared_ptr<Heightmap> GetHeightmap() const { return m_heightmap; }
+	const HeightmapTexture& GetHeightmapTexture() const { return m_heightmapTexture; }
 	Shadowmap& GetShadowmap() { return m_shadowmap; }
 	const std::vector<GLuint> GetTextureIDs() const { return m_textureIDs; }
-	const std::vector<float> GetVeritices() const { return m_vertices;}
-	const std::vector<float> GetTextureCoords() const { return m_textureCoords; }
-	const std::vector<int> GetIndices() const { return m_indices; }
+	const TerrainQuadtree& GetQuadtree() const { return m_quadtree; }
+	const HeightPyramid& GetHeightPyramid() const { return m_heightPyramid; }
+	const int GetRevision() const { return m_revision; }
+	TerrainSelection SelectLod(const Frustum& frustum, glm::vec3 cameraPosition, float lodDistance) const;
+	TerrainSelection SelectLevel(const Frustum& frustum, int level) const;
 
 private:
 	Model m_model;
 	std::shared_ptr<Heightmap> m_heightmap;
+	HeightmapTexture m_heightmapTexture;
 	Shadowmap m_shadowmap;
 	std::vector<GLuint> m_textureIDs;
-	std::vector<float> m_vertices;
-	std::vector<float> m_textureCoords;
-	std::vector<int> m_indices;
+	TerrainQuadtree m_quadtree;
+	HeightPyramid m_heightPyramid;
+	int m_revision = -1; // changes whenever Update sees changed heights
+
+	//bytes of a replacement uploaded per frame, small enough to stay inside the frame budget
+	static const size_t REPLACEMENT_UPLOAD_BUDGET = 4 * 1024 * 1024;
+	std::unique_ptr<GeneratedTerrain> m_replacement;
+	HeightmapTexture m_backHeightmapTexture; // receives the replacement, then trades places with the current texture
+	int m_replacementUploadedRows = 0;
 };
 
 class TerrainFactory {
@@ -38,4 +59,8 @@ public:
 	TerrainFactory() = default;
 
 	Terrain GenerateTerrain(DataFactory dataFactory, float size, int resolution, std::vector<GLuint> textureIDs, float noiseSeed);
+	Terrain GenerateTerrain(DataFactory dataFactory, std::shared_ptr<Heightmap> heightmap, std::vector<GLuint> textureIDs);
+
+private:
+	Model GeneratePatchModel(DataFactory& dataFactory);
 };
\ No newline at end of file
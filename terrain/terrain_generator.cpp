@@ -0,0 +1,143 @@
+#include <algorithm>
+#include "terrain_generator.h"
+
+//share of the progress bar spent on noise, the rest is the quadtree and pyramid
+static const float NOISE_PROGRESS = 0.9f;
+
+TerrainGenerator::TerrainGenerator() {
+    m_worker = std::thread(&TerrainGenerator::WorkerLoop, this);
+}
+
+TerrainGenerator::~TerrainGenerator() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_cancelled = true;
+    }
+    m_condition.notify_all();
+    m_worker.join();
+}
+
+void TerrainGenerator::Request(const TerrainGenerationSettings& settings) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingSettings = settings;
+        m_hasPendingRequest = true;
+        m_cancelled = true;
+        m_busy = true;
+    }
+    m_condition.notify_all();
+}
+
+void TerrainGenerator::Cancel() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hasPendingRequest = false;
+    m_result.reset();
+    m_cancelled = true;
+    m_discardResults = true;
+}
+
+//every level counts the same, the coarse ones are quick but they are what the user sees first
+float TerrainGenerator::GetProgress() const {
+    float levelProgress = m_buildingBounds ? NOISE_PROGRESS : m_noiseProgress.load() * NOISE_PROGRESS;
+    return (m_level.load() + levelProgress) / LEVEL_COUNT;
+}
+
+//full resolution divided by 8, 4, 2 and 1, the first level also shrunk to at most PREVIEW_RESOLUTION
+int TerrainGenerator::GetLevelResolution(int resolution, int level) {
+    int divisor = 1 << (LEVEL_COUNT - 1 - level);
+    int levelResolution = std::max((resolution + divisor - 1) / divisor, 2);
+    if (level == 0) {
+        levelResolution = std::min(levelResolution, PREVIEW_RESOLUTION);
+    }
+    return std::min(levelResolution, resolution);
+}
+
+std::unique_ptr<GeneratedTerrain> TerrainGenerator::TakeResult() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::move(m_result);
+}
+
+//runs one request at a time, level by level. requests that arrive meanwhile only overwrite the pending settings, so a
+//slider that keeps moving costs one stale level at most
+void TerrainGenerator::WorkerLoop() {
+    while (true) {
+        TerrainGenerationSettings settings;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_busy = m_hasPendingRequest;
+            m_condition.wait(lock, [this]() { return m_stopping || m_hasPendingRequest; });
+            if (m_stopping) {
+                return;
+            }
+            settings = m_pendingSettings;
+            //the snapshot shouldn't outlive the job, a shared sculpt layer is copied by the next stroke
+            m_pendingSettings = TerrainGenerationSettings();
+            m_hasPendingRequest = false;
+            m_cancelled = false;
+            m_discardResults = false;
+            m_busy = true;
+        }
+
+        int resolution = int(settings.size * 2);
+        int previousResolution = 0;
+        for (int level = 0; level < LEVEL_COUNT; level++) {
+            int levelResolution = GetLevelResolution(resolution, level);
+            m_level = level;
+            m_noiseProgress = 0.f;
+            m_buildingBounds = false;
+            //small maps reach the full resolution before the last level
+            if (levelResolution == previousResolution) {
+                continue;
+            }
+            previousResolution = levelResolution;
+
+            std::unique_ptr<GeneratedTerrain> generated = Generate(settings, levelResolution);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            //a level that got to finish is still shown when a newer request came in meanwhile, a slightly stale preview
+            //is better feedback than none while a slider keeps moving. the finer levels aren't worth generating though
+            bool finished = generated != nullptr;
+            if (finished) {
+                generated->preview = levelResolution < resolution;
+            }
+            if (finished && !m_discardResults) {
+                m_result = std::move(generated);
+            }
+            if (!finished || m_cancelled || m_hasPendingRequest) {
+                break;
+            }
+        }
+    }
+}
+
+std::unique_ptr<GeneratedTerrain> TerrainGenerator::Generate(const TerrainGenerationSettings& settings, int resolution) {
+    std::unique_ptr<GeneratedTerrain> generated = std::make_unique<GeneratedTerrain>();
+    generated->settings = settings;
+    generated->heightmap = std::make_shared<Heightmap>(settings.size, resolution);
+    generated->heightmap->SetLayers(settings.layers);
+    //previews get the sculpting resampled to their resolution
+    if (settings.sculptLayer) {
+        generated->heightmap->SetSculptLayer(*settings.sculptLayer);
+    }
+
+    //the first preview is small enough to always finish. cancelling it too would leave a slider that moves every frame
+    //without any feedback
+    const std::atomic<bool>* cancelled = resolution <= PREVIEW_RESOLUTION ? nullptr : &m_cancelled;
+    if (!generated->heightmap->UpdateLayers(cancelled, &m_noiseProgress)) {
+        return nullptr;
+    }
+    m_buildingBounds = true;
+
+    HeightmapRegion wholeMap;
+    wholeMap.Include(0, 0);
+    wholeMap.Include(resolution - 1, resolution - 1);
+    generated->quadtree = TerrainQuadtree(settings.size, resolution);
+    generated->quadtree.UpdateBounds(*generated->heightmap, wholeMap);
+    if (cancelled && *cancelled) {
+        return nullptr;
+    }
+    generated->heightPyramid = HeightPyramid(*generated->heightmap);
+    generated->heightmap->ClearDirtyRegion();
+    return generated;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "heightmap.h"
+#include "terrain_quadtree.h"
+#include "height_pyramid.h"
+
+// Everything that decides what a generated terrain looks like. The layers and sculpt offsets are a snapshot taken with
+// Heightmap::GetLayers and GetSculptLayer, layers whose noise is cached at the generated resolution aren't sampled again.
+// The sculpt offsets are only read while the request is in flight, they must not change until it finished
+struct TerrainGenerationSettings {
+	float size = 0.f;
+	std::vector<HeightmapLayer> layers; // the base noise first
+	std::shared_ptr<const HeightField> sculptLayer;
+};
+
+// Heights generated off the render thread, together with the CPU data the terrain derives from them, so swapping
+// them in only leaves the texture upload for the render thread
+struct GeneratedTerrain {
+	TerrainGenerationSettings settings;
+	std::shared_ptr<Heightmap> heightmap;
+	TerrainQuadtree quadtree;
+	HeightPyramid heightPyramid;
+	bool preview = false; // a coarser level, a finer one follows unless the request is replaced
+};
+
+// Generates terrains on a worker thread into a back buffer while the current terrain keeps rendering. Only the latest
+// request matters, a new request cancels the job in flight.
+//
+// A request is refined progressively. The first result is a small grid that is ready within a frame or two, each one
+// after doubles the detail up to the full resolution. The GPU filters the coarse heightmap texture linearly, which
+// upsamples the preview for free. While a slider keeps moving only the coarse levels get to finish.
+class TerrainGenerator {
+public:
+	// the first preview never has more texels per side than this, so its latency doesn't grow with the map
+	static const int PREVIEW_RESOLUTION = 128;
+	// resolution divisors of the refinement levels, the first one is capped at PREVIEW_RESOLUTION
+	static const int LEVEL_COUNT = 4;
+
+	TerrainGenerator();
+	~TerrainGenerator();
+
+	//prevent copying
+	TerrainGenerator(const TerrainGenerator&) = delete;
+	TerrainGenerator& operator=(const TerrainGenerator&) = delete;
+
+	void Request(const TerrainGenerationSettings& settings);
+	void Cancel();
+
+	// the newest level finished since the last call, nullptr if there is none. every result is handed out once
+	std::unique_ptr<GeneratedTerrain> TakeResult();
+
+	bool IsBusy() const { return m_busy.load(); }
+	// progress of the job in flight across all its levels, [0, 1]
+	float GetProgress() const;
+	// the level being generated, [0, LEVEL_COUNT)
+	int GetLevel() const { return m_level.load(); }
+
+private:
+	void WorkerLoop();
+	std::unique_ptr<GeneratedTerrain> Generate(const TerrainGenerationSettings& settings, int resolution);
+	static int GetLevelResolution(int resolution, int level);
+
+	std::thread m_worker;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	TerrainGenerationSettings m_pendingSettings;
+	bool m_hasPendingRequest = false;
+	bool m_stopping = false;
+	std::unique_ptr<GeneratedTerrain> m_result;
+	bool m_discardResults = false; // set by Cancel until the next job starts
+
+	std::atomic<bool> m_cancelled{ false }; // set when the job in flight went stale
+	std::atomic<bool> m_busy{ false };
+	std::atomic<int> m_level{ 0 };
+	std::atomic<float> m_noiseProgress{ 0.f };
+	std::atomic<bool> m_buildingBounds{ false }; // noise is done, the quadtree and pyramid are being built
+};
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cfloat>
+#include "terrain_quadtree.h"
+#include "../util/thread_pool.h"
+
+TerrainQuadtree::TerrainQuadtree(float size, int resolution) : m_size(size), m_gridQuads(resolution - 1) {
+    //add levels until a single node covers the whole grid
+    m_levelCount = 1;
+    while (GetNodeQuads(m_levelCount - 1) < m_gridQuads) {
+        m_levelCount++;
+    }
+
+    for (int level = 0; level < m_levelCount; level++) {
+        int nodesPerSide = (m_gridQuads + GetNodeQuads(level) - 1) / GetNodeQuads(level);
+        m_nodesPerSide.push_back(nodesPerSide);
+        m_heightRanges.push_back(std::vector<glm::vec2>(nodesPerSide * nodesPerSide, glm::vec2(0.f)));
+    }
+}
+
+//recompute the height range of the nodes overlapping the region. level 0 nodes scan the heightmap, every level above
+//merges its children
+void TerrainQuadtree::UpdateBounds(const Heightmap& heightmap, const HeightmapRegion& region) {
+    if (region.IsEmpty()) {
+        return;
+    }
+
+    int resolution = m_gridQuads + 1;
+
+    for (int level = 0; level < m_levelCount; level++) {
+        int nodeQuads = GetNodeQuads(level);
+        int nodesPerSide = m_nodesPerSide[level];
+
+        //level 0 nodes also cover the texel just past each of their borders, see the scan below
+        int startNodeX = std::max((region.minX - 2) / nodeQuads, 0);
+        int startNodeZ = std::max((region.minZ - 2) / nodeQuads, 0);
+        int endNodeX = std::min((region.maxX + 1) / nodeQuads, nodesPerSide - 1);
+        int endNodeZ = std::min((region.maxZ + 1) / nodeQuads, nodesPerSide - 1);
+
+        std::vector<glm::vec2>& ranges = m_heightRanges[level];
+
+        if (level == 0) {
+            util::ThreadPool::Get().ParallelFor(startNodeZ, endNodeZ + 1, 1, [&](int rowBegin, int rowEnd) {
+                for (int nodeZ = rowBegin; nodeZ < rowEnd; nodeZ++) {
+                    for (int nodeX = startNodeX; nodeX <= endNodeX; nodeX++) {
+                        //the vertex shader filters the heightmap linearly, so include the texels bordering the node as well
+                        int startX = std::max(nodeX * nodeQuads - 1, 0);
+                        int endX = std::min((nodeX + 1) * nodeQuads + 1, resolution - 1);
+                        int startZ = std::max(nodeZ * nodeQuads - 1, 0);
+                        int endZ = std::min((nodeZ + 1) * nodeQuads + 1, resolution - 1);
+
+                        float minHeight = FLT_MAX;
+                        float maxHeight = -FLT_MAX;
+                        for (int z = startZ; z <= endZ; z++) {
+                            for (int x = startX; x <= endX; x++) {
+                                float height = heightmap.GetHeight(x, z);
+                                minHeight = std::min(minHeight, height);
+                                maxHeight = std::max(maxHeight, height);
+                            }
+                        }
+                        ranges[nodeZ * nodesPerSide + nodeX] = glm::vec2(minHeight, maxHeight);
+                    }
+                }
+            });
+            continue;
+        }
+
+        const std::vector<glm::vec2>& childRanges = m_heightRanges[level - 1];
+        int childNodesPerSide = m_nodesPerSide[level - 1];
+        for (int nodeZ = startNodeZ; nodeZ <= endNodeZ; nodeZ++) {
+            for (int nodeX = startNodeX; nodeX <= endNodeX; nodeX++) {
+                glm::vec2 range(FLT_MAX, -FLT_MAX);
+                for (int quadrant = 0; quadrant < 4; quadrant++) {
+                    int childX = nodeX * 2 + (quadrant & 1);
+                    int childZ = nodeZ * 2 + (quadrant >> 1);
+                    if (childX >= childNodesPerSide || childZ >= childNodesPerSide) {
+                        continue;
+                    }
+                    const glm::vec2& childRange = childRanges[childZ * childNodesPerSide + childX];
+                    range.x = std::min(range.x, childRange.x);
+                    range.y = std::max(range.y, childRange.y);
+                }
+                ranges[nodeZ * nodesPerSide + nodeX] = range;
+            }
+        }
+    }
+}
+
+//world space box of a node, clipped to the edge of the map
+void TerrainQuadtree::GetNodeBounds(int level, int nodeX, int nodeZ, glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+    int nodeQuads = GetNodeQuads(level);
+    float quadSize = 2.f * m_size / m_gridQuads;
+    const glm::vec2& heightRange = m_heightRanges[level][nodeZ * m_nodesPerSide[level] + nodeX];
+
+    boundsMin = glm::vec3(nodeX * nodeQuads * quadSize - m_size, heightRange.x, nodeZ * nodeQuads * quadSize - m_size);
+    boundsMax = glm::vec3(std::min((nodeX + 1) * nodeQuads, m_gridQuads) * quadSize - m_size, heightRange.y,
+                          std::min((nodeZ + 1) * nodeQuads, m_gridQuads) * quadSize - m_size);
+}
+
+static bool SphereIntersectsBox(const glm::vec3& center, float radius, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 closest = glm::clamp(center, boundsMin, boundsMax);
+    glm::vec3 offset = center - closest;
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+//lodDistance is how far away a quad of unit size still covers the target number of pixels
+TerrainSelection TerrainQuadtree::Select(const Frustum& frustum, glm::vec3 cameraPosition, float lodDistance) const {
+    TerrainSelection selection;
+    selection.cameraPosition = cameraPosition;
+
+    //every level covers twice the distance of the one below it. a level 0 node has to be small against its range or a node
+    //two levels coarser could end up next to it and leave a crack
+    float quadSize = 2.f * m_size / m_gridQuads;
+    float nodeSize = PATCH_QUADS * quadSize;
+    float range = std::max(quadSize * lodDistance, 4.f * nodeSize);
+
+    const float morphStartRatio = .7f; //morph over the last 30% of a level's range
+    std::vector<float> ranges;
+    float previousRange = 0.f;
+    for (int level = 0; level < m_levelCount; level++) {
+        ranges.push_back(range);
+        selection.morphRanges.push_back(glm::vec2(previousRange + (range - previousRange) * morphStartRatio, range));
+        previousRange = range;
+        range *= 2.f;
+    }
+
+    //past the range of the root, the root is still drawn at the coarsest level
+    int rootLevel = m_levelCount - 1;
+    if (!SelectNode(rootLevel, 0, 0, frustum, ranges, selection)) {
+        selection.patches.push_back({ 0, 0, rootLevel, -1 });
+    }
+
+    return selection;
+}
+
+//returns false if the node is outside of its level's range, meaning the parent has to cover its area
+bool TerrainQuadtree::SelectNode(int level, int nodeX, int nodeZ, const Frustum& frustum, const std::vector<float>& ranges, TerrainSelection& selection) const {
+    glm::vec3 boundsMin, boundsMax;
+    GetNodeBounds(level, nodeX, nodeZ, boundsMin, boundsMax);
+
+    if (!frustum.IntersectsBox(boundsMin, boundsMax)) {
+        selection.nodesCulled++;
+        return true;
+    }
+
+    if (!SphereIntersectsBox(selection.cameraPosition, ranges[level], boundsMin, boundsMax)) {
+        return false;
+    }
+
+    int nodeQuads = GetNodeQuads(level);
+    TerrainPatch patch = { nodeX * nodeQuads, nodeZ * nodeQuads, level, -1 };
+
+    //nothing closer than the next finer range, draw the node at this level
+    if (level == 0 || !SphereIntersectsBox(selection.cameraPosition, ranges[level - 1], boundsMin, boundsMax)) {
+        selection.patches.push_back(patch);
+        return true;
+    }
+
+    int childNodesPerSide = m_nodesPerSide[level - 1];
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        int childX = nodeX * 2 + (quadrant & 1);
+        int childZ = nodeZ * 2 + (quadrant >> 1);
+        if (childX >= childNodesPerSide || childZ >= childNodesPerSide) {
+            continue; // past the edge of the map
+        }
+
+        //children out of their own range are drawn as a quadrant of this node
+        if (!SelectNode(level - 1, childX, childZ, frustum, ranges, selection)) {
+            patch.quadrant = quadrant;
+            selection.patches.push_back(patch);
+        }
+    }
+    return true;
+}
+
+//every visible node of a single level without morphing, for views that are not tied to the camera such as the shadowmap
+TerrainSelection TerrainQuadtree::SelectLevel(const Frustum& frustum, int level) const {
+    TerrainSelection selection;
+    selection.cameraPosition = glm::vec3(0.f);
+
+    //a morph range that starts past any distance keeps the morph factor at 0
+    level = std::clamp(level, 0, m_levelCount - 1);
+    selection.morphRanges.assign(m_levelCount, glm::vec2(FLT_MAX * .5f, FLT_MAX));
+
+    SelectNodeAtLevel(m_levelCount - 1, 0, 0, frustum, level, selection);
+    return selection;
+}
+
+void TerrainQuadtree::SelectNodeAtLevel(int level, int nodeX, int nodeZ, const Frustum& frustum, int targetLevel, TerrainSelection& selection) const {
+    glm::vec3 boundsMin, boundsMax;
+    GetNodeBounds(level, nodeX, nodeZ, boundsMin, boundsMax);
+
+    if (!frustum.IntersectsBox(boundsMin, boundsMax)) {
+        selection.nodesCulled++;
+        return;
+    }
+
+    int nodeQuads = GetNodeQuads(level);
+    if (level == targetLevel) {
+        selection.patches.push_back({ nodeX * nodeQuads, nodeZ * nodeQuads, level, -1 });
+        return;
+    }
+
+    int childNodesPerSide = m_nodesPerSide[level - 1];
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        int childX = nodeX * 2 + (quadrant & 1);
+        int childZ = nodeZ * 2 + (quadrant >> 1);
+        if (childX < childNodesPerSide && childZ < childNodesPerSide) {
+            SelectNodeAtLevel(level - 1, childX, childZ, frustum, targetLevel, selection);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "heightmap.h"
+#include "../engine/frustum.hpp"
+
+// A node of the quadtree picked for drawing. The terrain patch mesh is placed at the node origin and scaled by 2^level,
+// either whole or only one of its quadrants.
+struct TerrainPatch {
+	int originX; // grid quads
+	int originZ;
+	int level;
+	int quadrant; // -1 for the whole patch, 0-3 for one quadrant (x then z)
+};
+
+// The patches to draw for one view, plus the distances over which each level morphs into the next coarser one
+struct TerrainSelection {
+	std::vector<TerrainPatch> patches;
+	std::vector<glm::vec2> morphRanges; // (start, end) per level
+	glm::vec3 cameraPosition;
+	int nodesCulled = 0;
+};
+
+// Continuous distance-based level of detail (CDLOD) over the terrain grid.
+// Each level doubles the area a node covers while every node is drawn with the same patch mesh, so the number of
+// triangles depends on the view distance ranges rather than the size of the map.
+class TerrainQuadtree {
+public:
+	static const int PATCH_QUADS = 32; // quads per side of the patch mesh and of a level 0 node
+
+	TerrainQuadtree() = default;
+	TerrainQuadtree(float size, int resolution);
+
+	void UpdateBounds(const Heightmap& heightmap, const HeightmapRegion& region);
+	TerrainSelection Select(const Frustum& frustum, glm::vec3 cameraPosition, float lodDistance) const;
+	TerrainSelection SelectLevel(const Frustum& frustum, int level) const;
+
+	int GetLevelCount() const { return m_levelCount; }
+
+private:
+	int GetNodeQuads(int level) const { return PATCH_QUADS << level; }
+	void GetNodeBounds(int level, int nodeX, int nodeZ, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+	bool SelectNode(int level, int nodeX, int nodeZ, const Frustum& frustum, const std::vector<float>& ranges, TerrainSelection& selection) const;
+	void SelectNodeAtLevel(int level, int nodeX, int nodeZ, const Frustum& frustum, int targetLevel, TerrainSelection& selection) const;
+
+	float m_size;
+	int m_gridQuads;
+	int m_levelCount;
+	std::vector<int> m_nodesPerSide;
+	std::vector<std::vector<glm::vec2>> m_heightRanges; // (min, max) of each node, row major per level
+};
@@ -0,0 +1,101 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace util {
+    MappedFile::~MappedFile() {
+        Close();
+    }
+
+#ifdef _WIN32
+    bool MappedFile::Open(const std::string& filePath) {
+        Close();
+
+        HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        m_fileHandle = file;
+        m_mappingHandle = mapping;
+        m_data = data;
+        m_size = size_t(fileSize.QuadPart);
+        return true;
+    }
+
+    void MappedFile::Close() {
+        if (m_data) {
+            UnmapViewOfFile(m_data);
+            CloseHandle(m_mappingHandle);
+            CloseHandle(m_fileHandle);
+        }
+        m_data = nullptr;
+        m_mappingHandle = nullptr;
+        m_fileHandle = nullptr;
+        m_size = 0;
+    }
+#else
+    bool MappedFile::Open(const std::string& filePath) {
+        Close();
+
+        int file = open(filePath.c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+
+        struct stat fileStat;
+        if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0) {
+            close(file);
+            return false;
+        }
+
+        //the mapping keeps the file referenced, so the descriptor isn't needed after this
+        void* data = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        madvise(data, size_t(fileStat.st_size), MADV_SEQUENTIAL);
+
+        m_data = data;
+        m_size = size_t(fileStat.st_size);
+        return true;
+    }
+
+    void MappedFile::Close() {
+        if (m_data) {
+            munmap(m_data, m_size);
+        }
+        m_data = nullptr;
+        m_size = 0;
+    }
+#endif
+}
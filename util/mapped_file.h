@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace util {
+
+	// Read only view of a whole file mapped into memory. The OS pages the file in as it is read, so large files can be
+	// copied straight out of the page cache without going through a stream.
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		//prevent copying
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool Open(const std::string& filePath);
+		void Close();
+
+		bool IsOpen() const { return m_data != nullptr; }
+		const unsigned char* GetData() const { return static_cast<const unsigned char*>(m_data); }
+		size_t GetSize() const { return m_size; }
+
+	private:
+		void* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		void* m_fileHandle = nullptr;
+		void* m_mappingHandle = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include "thread_pool.h"
+
+namespace util {
+    ThreadPool::ThreadPool(unsigned int threadCount) {
+        for (unsigned int i = 0; i < threadCount; i++) {
+            m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        for (std::thread& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool& ThreadPool::Get() {
+        static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    void ThreadPool::Enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push(std::move(task));
+        }
+        m_condition.notify_one();
+    }
+
+    void ThreadPool::WorkerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+                if (m_stopping && m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+            task();
+        }
+    }
+
+    void ThreadPool::ParallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& body) {
+        if (end <= begin) {
+            return;
+        }
+
+        grainSize = std::max(grainSize, 1);
+        int bandCount = (end - begin + grainSize - 1) / grainSize;
+        if (bandCount == 1 || m_workers.empty()) {
+            //still one call per band, bodies that poll for cancellation or report progress between bands rely on it
+            for (int bandBegin = begin; bandBegin < end; bandBegin += grainSize) {
+                body(bandBegin, std::min(bandBegin + grainSize, end));
+            }
+            return;
+        }
+
+        //bands are claimed through a shared counter. helpers that start after every band is taken exit without touching body,
+        //so the state has to outlive this call but body doesn't
+        struct Bands {
+            std::atomic<int> next{ 0 };
+            std::atomic<int> finished{ 0 };
+            std::mutex mutex;
+            std::condition_variable done;
+        };
+        auto bands = std::make_shared<Bands>();
+        const std::function<void(int, int)>* bodyPtr = &body;
+
+        auto runBands = [bands, bodyPtr, begin, end, grainSize, bandCount]() {
+            int band;
+            while ((band = bands->next.fetch_add(1)) < bandCount) {
+                int bandBegin = begin + band * grainSize;
+                (*bodyPtr)(bandBegin, std::min(bandBegin + grainSize, end));
+
+                if (bands->finished.fetch_add(1) + 1 == bandCount) {
+                    std::lock_guard<std::mutex> lock(bands->mutex);
+                    bands->done.notify_all();
+                }
+            }
+        };
+
+        int helperCount = std::min<int>(bandCount - 1, static_cast<int>(m_workers.size()));
+        for (int i = 0; i < helperCount; i++) {
+            Enqueue(runBands);
+        }
+        runBands();
+
+        std::unique_lock<std::mutex> lock(bands->mutex);
+        bands->done.wait(lock, [&bands, bandCount]() { return bands->finished.load() == bandCount; });
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+	// A fixed set of worker threads shared by the application for data-parallel work.
+	class ThreadPool {
+	public:
+		explicit ThreadPool(unsigned int threadCount);
+		~ThreadPool();
+
+		//prevent copying
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// global pool sized to the machine, leaving one core for the calling thread
+		static ThreadPool& Get();
+
+		unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+		// run a task on a worker and get a future for its result. a pool without workers runs it before returning
+		template<typename Task>
+		auto Submit(Task task) -> std::future<decltype(task())> {
+			auto packagedTask = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+			std::future<decltype(task())> result = packagedTask->get_future();
+			if (m_workers.empty()) {
+				(*packagedTask)();
+			}
+			else {
+				Enqueue([packagedTask]() { (*packagedTask)(); });
+			}
+			return result;
+		}
+
+		// split [begin, end) into bands of grainSize and run body(bandBegin, bandEnd) for each band across the pool.
+		// the calling thread works on bands too, so nested calls from inside a worker can't deadlock
+		void ParallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& body);
+
+	private:
+		void Enqueue(std::function<void()> task);
+		void WorkerLoop();
+
+		std::vector<std::thread> m_workers;
+		std::queue<std::function<void()>> m_tasks;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		bool m_stopping = false;
+	};
+}